@@ -260,6 +260,7 @@ const uint32_t II_ALIGN        = 0x10000000;  // align directive
 const uint32_t II_OPTIONS      = 0x20000000;  // options directive
 
 const int MAX_ALIGN              =     4096;  // maximum allowed alignment  (note: if changed, change also in error.cpp at ERR_ALIGNMENT)
+const int MAX_INCLUDE_DEPTH      =       16;  // maximum nesting level of include files
 
 // Bit values generated by fitConstant() and stored in SCode::fitNumX
 // Indicates how many bits are needed to contain address offset or immediate constant of an instruction
@@ -333,7 +334,7 @@ struct SToken {
     uint32_t stringLength;        // Length of token as string
     uint16_t priority;            // Priority if operator
     uint16_t vartype;             // 0: value not known, 3: int64, 5: double, 8: string
-    uint32_t unused;
+    uint32_t constants;           // first entry in constantExpressions for expressions beginning here. 0 = none
     union {                       // value if constant or assemble-time variable
         uint64_t u;
         int64_t  i;
@@ -413,6 +414,80 @@ struct SCode : public SExpression {
     uint8_t  category;            // instruction category
 };
 
+// struct SConstantExpression is used for remembering the value of an expression or subexpression
+// that contains only literal numbers and operators, so that it is evaluated only once
+struct SConstantExpression {
+    SExpression expr;             // value of expression
+    uint32_t maxtok;              // maxtok parameter to expression()
+    uint32_t options;             // options parameter to expression(), except 0x10
+    uint32_t next;                // next entry for expression beginning with the same token. 0 = none
+    uint32_t unused;              // alignment
+};
+
+// struct SFitCache is used for remembering the best instruction variant and format for a combination of operands.
+// The first 40 bytes are the key. They contain the properties of the code that instructionFits and
+// jumpInstructionFits depend on, but not the values of constants and offsets
+struct SFitCache {
+    uint32_t instruction;         // instruction id
+    uint32_t etype;               // kinds of operands and options, XPR_...
+    uint32_t dtype;               // data type
+    uint32_t fitNum;              // sizes that the immediate constant fits into
+    uint32_t fitAddr;             // sizes that the memory offset fits into
+    uint32_t fitJump;             // sizes that the jump offset fits into
+    uint32_t registers;           // register classes, equal registers, and scale factor
+    uint32_t unused1;             // zero
+    uint64_t values;              // ranges of constants and offsets that some formats and variants check
+    SFormat const * formatp;      // best format
+    uint32_t instr;               // best instruction variant, index into instructionlistId. 0 = vacant
+    uint32_t unused;              // alignment
+};
+
+// struct SFunctionCacheHeader is the header of the cache file that the -incremental option uses for
+// remembering the code records that pass 3 made for each function in the previous run.
+// It is followed by a block for each function
+struct SFunctionCacheHeader {
+    char     signature[8];        // "FWCFUNC"
+    uint64_t environment;         // hash of options, instruction list, and formats
+    uint32_t numFunctions;        // number of function blocks
+    uint32_t unused;              // alignment
+};
+
+// struct SFunctionCache is the beginning of the block for one function in the cache file. It is followed by
+// numSymbols SFunctionCacheSymbol records, the names of these symbols, and the compressed code records
+struct SFunctionCache {
+    uint64_t key;                 // hash of the lines of the function and the state before it
+    uint32_t size;                // size of the block, including this record. divisible by 8
+    uint32_t numCodes;            // number of code records
+    uint32_t numSymbols;          // number of symbols
+    uint32_t namesSize;           // size of names, divisible by 8
+    uint32_t iLoop;               // high level statement counters after the function
+    uint32_t iIf;
+    uint32_t iSwitch;
+    uint32_t numSwitch;
+};
+
+// struct SFunctionCacheSymbol is a symbol that the code of a cached function depends on or makes.
+// The cached code records refer to symbols by index into these records + 1, line numbers are relative to
+// the function directive, and formatp is an index into formatList + 1, formatList3 + 0x10001, or formatList4 + 0x20001.
+// Each code record is compressed as a 64-bit mask of the nonzero 32-bit words, followed by these words
+struct SFunctionCacheSymbol {
+    ElfFwcSym sym;                // symbol before the function, or after the function if made by it. st_name is an offset into the names
+    uint32_t sectionAfter;        // st_section after the function
+    uint32_t sectionFlags;        // sh_flags of the section of the symbol
+    uint32_t symIndex;            // index into symbols in the previous run. Used for finding the symbol faster
+    uint32_t made;                // 1 if the symbol is made by the function
+};
+
+// struct SFunctionRecord is the state before a function that pass 3 is interpreting for the function cache
+struct SFunctionRecord {
+    uint64_t key;                 // key of SFunctionCache record
+    uint32_t line;                // line with function directive
+    uint32_t endLine;             // line with end directive. 0 = no function is being recorded
+    uint32_t firstCode;           // first code record of function in codeBuffer
+    uint32_t numErrors;           // number of errors before the function
+    uint32_t numSymbols;          // number of symbols before the function
+    uint32_t numCodes2;           // number of records in codeBuffer2 before the function
+};
 
 // struct SBlock is used for tracking {} code blocks
 struct SBlock  {
@@ -512,6 +587,7 @@ class CAssembler : public CFileBuffer {
 public:
     CAssembler();                                // Constructor
     void go();
+    void preloadIncludeFiles();                  // Tokenize include files before multiple files are assembled in separate processes
 protected:
     friend class CAssemErrors;                   // This class handles error messages
     uint32_t iInstr;                             // Position of current instruction relative to section start
@@ -546,7 +622,11 @@ protected:
     CDynamicArray<SInstruction3> instructionlistId; // List of instruction set, sorted by id
     CDynamicArray<SOperator> operators;          // List of operators
     CDynamicArray<SKeyword> keywords;            // List of keywords
-    CDynamicArray<ElfFWC_Sym2> symbols;          // List of symbols
+    CDynamicArray<ElfFWC_Sym2> symbols;          // List of symbols. Sorted by name only in pass 5
+    CDynamicArray<uint32_t> symbolHash;          // Hash table of symbol index + 1 by name. 0 = vacant
+    CDynamicArray<SReservedName> reservedNames;  // Register names, keywords, and instruction names
+    CDynamicArray<uint16_t> reservedHash;        // Perfect hash table of reservedNames index + 1. 0 = vacant
+    CDynamicArray<uint16_t> reservedSeeds;       // Hash seed for each bucket of reservedHash
     CDynamicArray<ElfFwcReloc> relocations;     // List of relocations
     CDynamicArray<uint8_t> brackets;             // Stack of nested brackets during evaluation of expression
     CDynamicArray<SCode> codeBuffer;             // Coded instructions
@@ -554,21 +634,48 @@ protected:
     CDynamicArray<ElfFwcShdr> sectionHeaders;    // Section headers
     CDynamicArray<SFormat> formatList3;          // Subset of formatList for multiformat instruction formats
     CDynamicArray<SFormat> formatList4;          // Subset of formatList for jump instruction formats
+    CMemoryBuffer includeNames;                  // Names of include files
+    CDynamicArray<uint32_t> includeFiles;        // Include files as index into includeNames. SLine::file = index + 2
+    uint32_t includeDepth;                       // Nesting level of current include file
+    CDynamicArray<SFitCache> fitCache;           // Hash table of results of fitCode
+    CDynamicArray<SConstantExpression> constantExpressions; // Values of literal expressions, linked from SToken::constants
+    uint32_t constantTokens;                     // Number of tokens made in pass 1. Temporary tokens after these are not linked
+    uint32_t fitCacheNum;                        // Number of used entries in fitCache
+    CMemoryBuffer functionCache;                 // New function blocks to save in the cache file for the -incremental option
+    CDynamicArray<uint32_t> functionCacheBlocks; // Offset of each function block to save. Bit 31 = in functionCache, else in oldFunctionCache
+    uint32_t functionCacheNew;                   // Number of function blocks in functionCache
+    CFileBuffer oldFunctionCache;                // Cache file from the previous run
+    CDynamicArray<uint32_t> oldFunctionHash;     // Hash table of function blocks in oldFunctionCache, as offset. 0 = vacant
+    CDynamicArray<SFunctionCacheSymbol> functionCacheSymbols; // Symbols of the function being saved
+    CMemoryBuffer functionCacheNames;            // Names of functionCacheSymbols
+    CMemoryBuffer functionCacheCodes;            // Compressed code records of the function being saved
+    CDynamicArray<uint32_t> functionSymbols;     // Index into functionCacheSymbols + 1 for each symbol
+    CDynamicArray<uint32_t> functionNameMemo;    // Index into symbols + 1 for recently used symbol names, by hash of name offset
+    CDynamicArray<uint32_t> functionLabels;      // Symbol index and old st_section of each label defined in the function being recorded
+    SFunctionRecord functionRecord;              // State before the function being recorded
     CDynamicArray<SBlock>  hllBlocks;            // Tracking of {} blocks    
     CDynamicArray<SExpression> expressions;      // Expressions saved as assemble-time symbols    
     CTextFileBuffer stringBuffer;                // Buffer for assemble-time string variables
     CMetaBuffer<CMemoryBuffer> dataBuffers;      // databuffer for each section
     CAssemErrors errors;                         // Error reporting
     void initializeWordLists();                  // Initialize and sort instruction list, operator list, and keyword list
+    int32_t findReservedName(const char * name, uint32_t len); // Find register name, keyword, or instruction name
     void feedBackText1();                        // write feedback text on stdout
     void pass1();                                // Split input file into lines and tokens. Handle preprocessing directives. Find symbol definitions
+    uint32_t tokenize(uint32_t n, uint32_t end); // Split source file or include file into lines and tokens
+    bool includeDirective(SLine const & line);   // Handle %include line during pass 1
+    void includeFile(const char * fname, SToken const & t2, SLine const & emptyLine); // Insert tokenized include file during pass 1
+    const char * fileName(uint32_t file);        // Name of source file or include file
     void interpretSectionDirective();            // Interpret section directive during pass 2 or 3
     void interpretFunctionDirective();           // Interpret function directive during pass 2 or 3
     void interpretEndDirective();                // Interpret section or function end directive during pass 2 or 3
     void interpretOptionsLine();                 // Interpret line specifying options
     uint32_t addSymbol(ElfFWC_Sym2 & sym);       // Add a symbol to symbols list
+    uint32_t addUniqueSymbol(ElfFWC_Sym2 & sym); // Add a symbol to symbols list if not already there. Return index
     uint32_t findSymbol(uint32_t name);          // Find symbol by index into symbolNameBuffer
     uint32_t findSymbol(const char * name, uint32_t len); // Find symbol by name with specified length
+    void symbolHashInsert(uint32_t symi);        // Insert symbol in symbolHash
+    void symbolHashRebuild();                    // Make symbolHash from symbols
     void pass2();                                // A. Handle metaprogramming directives
                                                  // B. Classify lines
                                                  // C. Identify symbol names, sections, labels, functions 
@@ -594,8 +701,18 @@ protected:
     void assignMetaVariable(uint32_t symi, SExpression & expr, uint32_t typetoken); // define or modify assemble-time constant or variable
     void pass3();                                // Generate code and data
     void makeFormatLists();                      // extract subsets of formatList into formatList3 and formatList4
+    void functionCacheLoad();                    // read cache file from the previous run for the -incremental option
+    uint64_t functionCacheEnvironment();         // hash of options, instruction list, and formats that cached code depends on
+    uint64_t functionHash(uint32_t line, uint32_t & endLine); // hash of the lines of a function. 0 if it cannot be cached
+    bool functionCacheBegin();                   // use code of unchanged function from the cache, or start recording it
+    bool functionCacheUse(uint32_t offset, uint32_t endLine); // use code of function from the cache of the previous run
+    void functionCacheSave();                    // save code of the function that has been recorded
+    uint32_t functionCacheSymbol(uint32_t name); // add symbol that the function being saved depends on or makes
+    void functionCacheWrite();                   // write cache file for the next run
     void interpretCodeLine();                    // Interpret a line defining code
     int  fitCode(SCode & code);                  // find an instruction variant that fits the code
+    SFitCache & fitCacheFind(SCode const & code, SFitCache & key, uint32_t instrIndex, uint32_t nInstr); // find entry in fitCache for the same operands
+    SFitCache & fitCacheSlot(SFitCache const & key); // find entry in fitCache with the same key
     bool instructionFits(SCode const & code, SCode & codeTemp, uint32_t ii); // check if instruction fits into specified format
     bool jumpInstructionFits(SCode const & code, SCode & codeTemp, uint32_t ii); // check if jump instruction fits into specified format
     int  fitConstant(SCode & code);              // check how many bits are needed to contain immediate constant in an instruction.
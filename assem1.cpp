@@ -14,7 +14,7 @@
 ******************************************************************************/
 #include "stdafx.h"
 
-const char * allowedInNames = "_$@";   // characters allowed in symbol names (don't allow characters that are used as operators)
+const char allowedInNames[] = "_$@";   // characters allowed in symbol names (don't allow characters that are used as operators)
 const bool allowUTF8 = true;           // UTF-8 characters allowed in symbol names
 const bool allowNestedComments = true; // allow nested comments: /* /* */ */
 
@@ -172,15 +172,13 @@ SKeyword registerNames[] = {
 
 
 CAssembler::CAssembler() {                                 // Constructor
-    // Reserve size for buffers
-    const int estimatedLineLength = 16;
-    const int estimatedTokensPerLine = 10;
-    int estimatedNumLines = dataSize() / estimatedLineLength;
-    lines.setNum(estimatedNumLines);
-    tokens.setNum(estimatedNumLines * estimatedTokensPerLine);
     errors.setOwner(this);
+    fitCacheNum = 0;
+    constantTokens = 0;
+    zeroAllMembers(functionRecord);
     // Initialize and sort lists
     initializeWordLists();
+    timingStage("initializeWordLists");
     ElfFwcShdr nullHeader;         // make first section header empty
     zeroAllMembers(nullHeader);
     sectionHeaders.push(nullHeader);
@@ -202,6 +200,7 @@ void CAssembler::go() {
         pass = 1;
         // Split input file into lines and tokens. Find symbol definitions
         pass1();
+        timingStage("pass1");
         if (errors.tooMany()) {err.submit(ERR_TOO_MANY_ERRORS);  break;}
 
         pass = 2;
@@ -209,6 +208,7 @@ void CAssembler::go() {
         // B. Classify lines
         // C. Identify symbol names, sections, labels, functions 
         pass2();
+        timingStage("pass2");
         if (errors.tooMany()) {err.submit(ERR_TOO_MANY_ERRORS);  break;}
 
         //showTokens();  //!! for debugging only
@@ -217,16 +217,19 @@ void CAssembler::go() {
         pass = 3;
         // Interpret lines. Generate code and data
         pass3();
+        timingStage("pass3");
         if (errors.tooMany()) {err.submit(ERR_TOO_MANY_ERRORS);  break;}
 
         pass = 4;
         // Resolve internal cross references, optimize forward references
         pass4();
+        timingStage("pass4");
         if (errors.tooMany()) {err.submit(ERR_TOO_MANY_ERRORS);  break;}
 
         pass = 5;
         // Make binary file
         pass5();
+        timingStage("pass5");
         if (errors.tooMany()) {err.submit(ERR_TOO_MANY_ERRORS);  break;}
 
     } while (false);
@@ -237,6 +240,9 @@ void CAssembler::go() {
     
     // output object file
     outFile.write(cmd.getFilename(cmd.outputFile));
+    // save code of functions for the next run
+    if ((cmd.assembleOptions & CMDL_ASM_INCREMENTAL) && errors.numErrors() == 0 && err.number() == 0) functionCacheWrite();
+    timingStage("write");
 }
 
 
@@ -250,6 +256,96 @@ inline bool nameChar2(char c) {
     return nameChar1(c) || (c >= '0' && c <= '9');
 }
 
+// The tokenizer scans names, spaces, and comments 16 bytes at a time with SSE2 instructions,
+// which are always available in x86-64. Other platforms use the simple loops
+#if defined(_M_X64) || defined(__x86_64__) || defined(__amd64)
+#define SSE2_SCAN 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+// Index of first set bit in nonzero mask
+static inline uint32_t firstBit(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, mask);
+    return i;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Set bytes in the range lo - hi to all ones. Unsigned compare
+static inline __m128i inRange(__m128i x, uint8_t lo, uint8_t hi) {
+    __m128i t = _mm_sub_epi8(x, _mm_set1_epi8((char)lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8((char)(hi - lo))), t);
+}
+#else
+#define SSE2_SCAN 0
+#endif
+
+// Find the end of a name. Returns the position of the first character from m that is not nameChar2
+static uint32_t scanName(const char * s, uint32_t m, uint32_t end) {
+#if SSE2_SCAN
+    // name characters are letters, digits, the characters in allowedInNames, UTF-8 bytes,
+    // and 0 because strchr in nameChar1 finds the terminator of allowedInNames
+    while (m + 16 <= end) {
+        __m128i x = _mm_loadu_si128((__m128i const *)(s + m));
+        __m128i ok = inRange(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z');
+        ok = _mm_or_si128(ok, inRange(x, '0', '9'));
+        for (uint32_t k = 0; k < sizeof(allowedInNames); k++) {  // including the terminating zero
+            ok = _mm_or_si128(ok, _mm_cmpeq_epi8(x, _mm_set1_epi8(allowedInNames[k])));
+        }
+        if (allowUTF8) ok = _mm_or_si128(ok, _mm_cmplt_epi8(x, _mm_setzero_si128()));
+        uint32_t mask = ~(uint32_t)_mm_movemask_epi8(ok) & 0xFFFF;
+        if (mask) return m + firstBit(mask);
+        m += 16;
+    }
+#endif
+    while (m < end && nameChar2(s[m])) m++;
+    return m;
+}
+
+// Skip spaces and tabs. Returns the position of the first other character from n
+static uint32_t skipSpace(const char * s, uint32_t n, uint32_t end) {
+#if SSE2_SCAN
+    while (n + 16 <= end) {
+        __m128i x = _mm_loadu_si128((__m128i const *)(s + n));
+        __m128i ok = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\t')));
+        uint32_t mask = ~(uint32_t)_mm_movemask_epi8(ok) & 0xFFFF;
+        if (mask) return n + firstBit(mask);
+        n += 16;
+    }
+#endif
+    while (n < end && (s[n] == ' ' || s[n] == '\t')) n++;
+    return n;
+}
+
+// Skip the text of a comment. Returns the position of the first control character other than tab,
+// which may be a newline. A /* */ comment (block = true) also stops at '/' and '*'. Other characters
+// inside a comment are ignored by pass1, also when they are the start of an operator
+static uint32_t skipComment(const char * s, uint32_t n, uint32_t end, bool block) {
+#if SSE2_SCAN
+    const __m128i slash = _mm_set1_epi8(block ? '/' : '\n');   // '\n' stops anyway
+    const __m128i star  = _mm_set1_epi8(block ? '*' : '\n');
+    while (n + 16 <= end) {
+        __m128i x = _mm_loadu_si128((__m128i const *)(s + n));
+        __m128i stop = _mm_andnot_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\t')), inRange(x, 0, 0x1F));
+        stop = _mm_or_si128(stop, _mm_or_si128(_mm_cmpeq_epi8(x, slash), _mm_cmpeq_epi8(x, star)));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(stop);
+        if (mask) return n + firstBit(mask);
+        n += 16;
+    }
+#endif
+    for (; n < end; n++) {
+        uint8_t c = (uint8_t)s[n];
+        if ((c < 0x20 && c != '\t') || (block && (c == '/' || c == '*'))) break;
+    }
+    return n;
+}
+
 // check if string is a number. Can be decimal, binary, octal, hexadecimal, or floating point
 // Returns the length of the part of the string that belongs to the number
 uint32_t isNumber(const char * s, int maxlen, bool * isFloat) {
@@ -289,32 +385,6 @@ uint32_t isNumber(const char * s, int maxlen, bool * isFloat) {
     return i;                               // return length
 }
 
-// Check if string is a register name
-uint32_t isRegister(const char * s, uint32_t len) {
-    uint32_t i, j, nl, num;
-    for (i = 0; i < TableSize(registerNames); i++) {
-        if ((s[0] | 0x20) == registerNames[i].name[0]) {   // first character match, lower case
-            nl = (uint32_t)strlen(registerNames[i].name);  // length of register name prefix
-            if (len < nl + 1 || len > nl + 2) continue;    // continue search if length wrong
-            for (j = 0; j < nl; j++) {                     // check if each character matches
-                if ((s[j] | 0x20) != registerNames[i].name[j]) { // lower case compare
-                    j = 0xFFFFFFFF; break;
-                }
-            }
-            if (j == 0xFFFFFFFF) continue;                 // no match
-            if (s[j] < '0' || s[j] > '9') continue;        // not a number
-            num = s[j] - '0';                              // get number, first digit
-            if (len == nl + 2) {                           // two digit number
-                if (s[j+1] < '0' || s[j+1] > '9') continue;// second digit not a number            
-                num = num * 10 + (s[j+1] - '0');
-            }
-            if (num >= 32) continue;                       // number too high
-            return num + registerNames[i].id;              // everyting matches
-        }
-    }
-    return 0;       // not found. return 0
-} 
-
 // write feedback text on stdout
 void CAssembler::feedBackText1() {
     if (cmd.verbose) {
@@ -327,49 +397,87 @@ void CAssembler::feedBackText1() {
 // Split input file into lines and tokens. Handle preprocessing directives. Find symbol definitions
 void CAssembler::pass1() {
     uint32_t n = 0;                // offset into assembly file
-    uint32_t m;                    // end of current token
-    int32_t  i, f;                 // temporary
-    int32_t  comment = 0;          // 0: normal, 1: inside comment to end of line, 2: inside /* */ comment
-    uint32_t commentStart = 0;     // start position of multiline comment
-    uint32_t commentStartColumn = 0;// start column of multiline comment
-    char c;                        // current character or byte
     SToken token = {0};            // current token
-    SKeyword keywSearch;           // record to search for keyword
-    SOperator opSearch;            // record to search for operator
-    SInstruction instructSearch;   // record to search for instruction
     SLine line = {0,0,0,0,0,0,0};  // line record
+    // Reserve space for lines and tokens from the size of the source file.
+    // This avoids repeated re-allocation and copying of big buffers
+    const uint32_t estimatedLineLength = 12;       // typical source files have 12 - 30 characters per line
+    const uint32_t estimatedTokenLength10 = 25;    // and 2.5 - 3.2 characters per token
+    if (dataSize() < 0x2000000) {                  // buffer sizes must fit into 32 bits
+        lines.setSize(dataSize() / estimatedLineLength * (uint32_t)sizeof(SLine));
+        tokens.setSize(dataSize() * 10 / estimatedTokenLength10 * (uint32_t)sizeof(SToken));
+    }
     lines.push(line);              // empty records for line 0
     linei = 1;                     // start at line 1
+    filei = 1;                     // source file
+    includeDepth = 0;
     numSwitch = 0;              // count switch statements
     tokens.push(token);            // unused token 0
 
     if (dataSize() >= 3 && (get<uint32_t>(0) & 0xFFFFFF) == 0xBFBBEF) {        
         n += 3;                    // skip UTF-8 byte order mark
     }
+    n = tokenize(n, dataSize());
+
+    // make EOF token in the end
+    line.file = filei;
+    line.linenum = linei - 1;
+    line.beginPos = n; 
+    line.firstToken = tokens.numEntries();
+    line.numTokens = 1;
+    lines.push(line);
+    token.pos   = n;
+    token.stringLength   = 0;
+    token.type = TOK_EOF;    // end of file
+    tokens.push(token);     // save eof token
+}
+
+// Split source file or include file into lines and tokens.
+// The text from n to end is in the input buffer. Include files are appended to the input buffer and
+// tokenized where the %include directive is. Returns the position after the last token
+uint32_t CAssembler::tokenize(uint32_t n, uint32_t end) {
+    uint32_t m;                    // end of current token
+    int32_t  i, f;                 // temporary
+    int32_t  comment = 0;          // 0: normal, 1: inside comment to end of line, 2: inside /* */ comment
+    uint32_t commentStart = 0;     // start position of multiline comment
+    uint32_t commentStartColumn = 0;// start column of multiline comment
+    char c;                        // current character or byte
+    SToken token = {0};            // current token
+    SOperator opSearch;            // record to search for operator
+    const char * s = (const char *)buf(); // input text
+    SLine line = {0,0,0,0,0,0,0};  // line record
 
     line.beginPos = n;             // start of line 1
     line.firstToken = tokens.numEntries();
     line.file = filei;
 
     // loop through file
-    while (n < dataSize()) {
-        c = get<char>(n);              // get character
+    while (n < end) {
+        if (comment) {
+            // inside a comment. skip to the next character that needs attention
+            n = skipComment(s, n, end, comment > 1);
+            if (n >= end) break;
+        }
+        c = s[n];                      // get character
 
         // is it space or a control character?
         if (uint8_t(c) <= 0x20) {                
             if (c == ' ' || c == '\t') {   // skip space and tab
-                n++;
+                n = skipSpace(s, n + 1, end);
                 continue;
             }
             if (c == '\r' || c == '\n') {  // newline
                 n++;
-                if (c == '\r' && get<char>(n) == '\n') n++;  // "\r\n" windows newline
+                if (c == '\r' && n < end && s[n] == '\n') n++;  // "\r\n" windows newline
                 if (comment == 1) comment = 0;                  // end comment
-                if (n <= dataSize()) {
+                if (n <= end) {
                     // finish current line
                     line.numTokens = tokens.numEntries() - line.firstToken;
                     line.linenum = linei++;
-                    if (line.numTokens) {  // save line if not empty                  
+                    if (includeDirective(line)) {
+                        s = (const char *)buf();   // include file has been added to input buffer
+                    }
+                    else if (line.numTokens) {  // save line if not empty                  
                         lines.push(line);
                     }                    
                     // start next line
@@ -382,6 +490,8 @@ void CAssembler::pass1() {
             } 
             // illegal control character
             token.type = TOK_ERR;
+            token.pos = n;
+            token.stringLength = 1;
             line.type = LINE_ERROR;
             comment = 1;              // ignore rest of line
             m = tokens.push(token);     // save error token
@@ -396,39 +506,18 @@ void CAssembler::pass1() {
         // is it a name?
         if (!comment && nameChar1(c)) {
             // start of a name
-            m = n+1;
-            while (m < dataSize() && nameChar2(get<char>(m))) m++;
+            m = scanName(s, n + 1, end);
             // name goes from position n to m-1. make token
             token.type = TOK_NAM;
             token.pos = n;
             token.stringLength = m - n;
 
-            // is it a register name
-            f = isRegister((char*)buf()+n, token.stringLength);
-            if (f) {
-                token.type = TOK_REG;
-                token.id = f;
-            }
-            // is it a keyword?
-            if (token.type == TOK_NAM && m-n < sizeof(keywSearch.name)) {
-                memcpy(keywSearch.name, buf()+n, m-n);
-                keywSearch.name[m-n] = 0;
-                f = keywords.findFirst(keywSearch);
-                if (f >= 0) {  // keyword found
-                    token.id = keywords[f].id;
-                    token.type = keywords[f].id >> 24;
-                    if (token.id == HLL_SWITCH) numSwitch++;
-                }
-            }
-            // is it an instruction?
-            if (token.type == TOK_NAM && m-n < sizeof(instructSearch.name)) {
-                memcpy(instructSearch.name, buf()+n, m-n);
-                instructSearch.name[m-n] = 0;
-                f = instructionlistNm.findFirst(instructSearch);
-                if (f >= 0) {  // instruction name found
-                    token.type = TOK_INS;
-                    token.id = instructionlistNm[f].id;
-                }
+            // is it a register name, keyword, or instruction?
+            f = findReservedName(s + n, m - n);
+            if (f >= 0) {
+                token.type = reservedNames[f].type;
+                token.id = reservedNames[f].id;
+                if (token.id == HLL_SWITCH) numSwitch++;
             }
             n = m;
             tokens.push(token);     // save token
@@ -438,7 +527,7 @@ void CAssembler::pass1() {
         // Is it a number?
         if (!comment) {
             bool isFloat;
-            f = isNumber((char*)buf() + n, dataSize() - n, &isFloat);
+            f = isNumber(s + n, end - n, &isFloat);
             if (f) {
                 token.type = TOK_NUM + isFloat;
                 token.id = n;               // save number as string. The value is extracted later
@@ -459,7 +548,7 @@ void CAssembler::pass1() {
             i = f;
             for (i = f+1; (uint32_t)i < operators.numEntries(); i++) {
                 if (operators[i].name[0] != c) break;
-                if (memcmp((char*)buf()+n, operators[i].name, strlen(operators[i].name)) == 0) f = i;
+                if (memcmp(s + n, operators[i].name, strlen(operators[i].name)) == 0) f = i;
             }
             token.type = TOK_OPR;
             token.id = operators[f].id;
@@ -594,29 +683,228 @@ void CAssembler::pass1() {
         n++;
     }
     // finish last line
-   // tokens.push(token);
     line.numTokens = tokens.numEntries() - line.firstToken;
-    lines.push(line);
-    // start pseudo line
-    line.beginPos = n;
-    line.firstToken = tokens.numEntries();
-    line.type = 0;
+    if (line.numTokens) line.linenum = linei;  // last line has no newline
+    if (!includeDirective(line)) lines.push(line);
 
     // check for unmatched comment
     if (comment >= 2) {
         token.type = TOK_ERR;
         errors.report(commentStart, commentStartColumn, ERR_COMMENT_BEGIN);
     }
-    // make EOF token in the end
-    line.type = 0;
-    line.beginPos = n; 
-    line.firstToken = tokens.numEntries();
-    line.numTokens = 1;
-    lines.push(line);
-    token.pos   = n;
-    token.stringLength   = 0;
-    token.type = TOK_EOF;    // end of file
-    tokens.push(token);     // save eof token
+    return n;
+}
+
+// Include files tokenized earlier in the same process, for example when multiple files are assembled
+// without fork. The text, tokens, and lines of an include file and the files it includes are saved
+// with positions relative to the start of the text, so that they can be copied instead of tokenized again
+struct SIncludeCache {
+    uint32_t name;                 // file name. offset into includeCacheData
+    uint32_t text;                 // text of file and nested include files. offset into includeCacheData
+    uint32_t textSize;             // size of text
+    uint32_t tokens;               // SToken records. offset into includeCacheData
+    uint32_t numTokens;            // number of tokens
+    uint32_t lines;                // SLine records. offset into includeCacheData
+    uint32_t numLines;             // number of lines
+    uint32_t files;                // names of the file and nested include files. offset into includeCacheData
+    uint32_t numFiles;             // number of file names
+    uint32_t numSwitch;            // number of switch statements
+};
+static CDynamicArray<SIncludeCache> includeCache;
+static CMemoryBuffer includeCacheData;
+
+// Make the path of an include file. The name in the directive is relative to the directory
+// of the file containing the directive, unless it is an absolute path
+static void includePath(CMemoryBuffer & name, const char * parent, const char * text, uint32_t length) {
+    const char * slash = strrchr(parent, '/');
+#if defined (_WIN32) || defined (__WINDOWS__)
+    if (strrchr(parent, '\\') > slash) slash = strrchr(parent, '\\');
+#endif
+    bool absolutePath = text[0] == '/' || text[0] == '\\' || (length > 1 && text[1] == ':');
+    if (slash && !absolutePath) name.push(parent, uint32_t(slash + 1 - parent));
+    name.push(text, length);
+    name.pushString("");
+}
+
+// Handle include directive during pass 1: %include "filename"
+// line is a finished line. Returns false if it is not an include directive.
+// Otherwise, the include file is appended to the input buffer and its lines and tokens
+// are inserted in place of the directive
+bool CAssembler::includeDirective(SLine const & line) {
+    if (line.numTokens != 3) return false;
+    SToken t0 = tokens[line.firstToken];
+    SToken t1 = tokens[line.firstToken + 1];
+    SToken t2 = tokens[line.firstToken + 2];
+    if (t0.type != TOK_OPR || t0.id != '%' || t1.type != TOK_NAM || t1.stringLength != 7 
+    || strncasecmp_((const char *)buf() + t1.pos, "include", 7) != 0 || t2.type != TOK_STR) return false;
+    tokens.setNum(line.firstToken);              // remove the directive
+    SLine emptyLine = line;                      // line without tokens, for error messages
+    emptyLine.numTokens = 0;
+    if (includeDepth >= MAX_INCLUDE_DEPTH) {     // probably recursive
+        lines.push(emptyLine);
+        errors.report(t2.pos, t2.stringLength, ERR_INCLUDE_DEPTH);
+        return true;
+    }
+    CMemoryBuffer name;
+    includePath(name, fileName(filei), (const char *)buf() + t2.pos, t2.stringLength);
+    includeFile((const char *)name.buf(), t2, emptyLine);
+    return true;
+}
+
+// Append include file fname to the input buffer and insert its lines and tokens.
+// t2 is the file name token and emptyLine is a line without tokens, for error messages
+void CAssembler::includeFile(const char * fname, SToken const & t2, SLine const & emptyLine) {
+    uint32_t textStart = dataSize();             // position of include file in input buffer
+    uint32_t tokenBase = tokens.numEntries();
+    uint32_t lineBase = lines.numEntries();
+    uint32_t fileBase = includeFiles.numEntries();
+    uint32_t i;
+
+    // use include file tokenized before if possible
+    for (uint32_t c = 0; c < includeCache.numEntries(); c++) {
+        SIncludeCache const & e = includeCache[c];
+        if (strcmp((const char *)includeCacheData.buf() + e.name, fname) != 0) continue;
+        push(includeCacheData.buf() + e.text, e.textSize);
+        tokens.pushBig((SToken const *)(includeCacheData.buf() + e.tokens), e.numTokens * (uint32_t)sizeof(SToken));
+        for (i = tokenBase; i < tokens.numEntries(); i++) {
+            tokens[i].pos += textStart;
+            if (tokens[i].type == TOK_NUM || tokens[i].type == TOK_FLT) tokens[i].id += textStart;
+        }
+        lines.pushBig((SLine const *)(includeCacheData.buf() + e.lines), e.numLines * (uint32_t)sizeof(SLine));
+        for (i = lineBase; i < lines.numEntries(); i++) {
+            lines[i].beginPos += textStart;
+            lines[i].firstToken += tokenBase;
+            lines[i].file += fileBase + 2;
+        }
+        const char * p = (const char *)includeCacheData.buf() + e.files;
+        for (i = 0; i < e.numFiles; i++) {
+            includeFiles.push(includeNames.pushString(p));
+            p += strlen(p) + 1;
+        }
+        numSwitch += e.numSwitch;
+        return;
+    }
+
+    // read include file
+    CFileBuffer file;
+    file.read(fname, CMDL_FILE_IN_IF_EXISTS);
+    if (file.dataSize() == 0) {
+        FILE * f = fopen(fname, "rb");
+        if (f) fclose(f);                        // empty file
+        else {
+            lines.push(emptyLine);
+            errors.report(t2.pos, t2.stringLength, ERR_INCLUDE_FILE);
+        }
+        return;
+    }
+    uint32_t numErrors = errors.numErrors();
+    uint32_t numSwitch0 = numSwitch;
+    push("\n", 1);                               // a string at the end of the preceding text must end here
+    uint32_t n = dataSize();
+    push(file.buf(), file.dataSize());
+    if (file.dataSize() >= 3 && (file.get<uint32_t>(0) & 0xFFFFFF) == 0xBFBBEF) {
+        n += 3;                                  // skip UTF-8 byte order mark
+    }
+    includeFiles.push(includeNames.pushString(fname));
+    uint32_t filei0 = filei, linei0 = linei;
+    filei = includeFiles.numEntries() + 1;
+    linei = 1;
+    includeDepth++;
+    tokenize(n, dataSize());
+    includeDepth--;
+    filei = filei0;  linei = linei0;
+    if (errors.numErrors() != numErrors || errors.tooMany()) return;  // don't save tokens with errors
+
+    // save tokenized file for next assembly in same process
+    SIncludeCache e;
+    e.name = includeCacheData.pushString(fname);
+    e.text = includeCacheData.push(buf() + textStart, dataSize() - textStart);
+    e.textSize = dataSize() - textStart;
+    e.tokens = includeCacheData.dataSize();
+    e.numTokens = tokens.numEntries() - tokenBase;
+    for (i = tokenBase; i < tokens.numEntries(); i++) {
+        SToken t = tokens[i];
+        t.pos -= textStart;
+        if (t.type == TOK_NUM || t.type == TOK_FLT) t.id -= textStart;
+        includeCacheData.push(&t, sizeof(t));
+    }
+    e.lines = includeCacheData.dataSize();
+    e.numLines = lines.numEntries() - lineBase;
+    for (i = lineBase; i < lines.numEntries(); i++) {
+        SLine l = lines[i];
+        l.beginPos -= textStart;
+        l.firstToken -= tokenBase;
+        l.file -= fileBase + 2;
+        includeCacheData.push(&l, sizeof(l));
+    }
+    e.files = includeCacheData.dataSize();
+    e.numFiles = includeFiles.numEntries() - fileBase;
+    for (i = fileBase; i < includeFiles.numEntries(); i++) {
+        includeCacheData.pushString((const char *)includeNames.buf() + includeFiles[i]);
+    }
+    e.numSwitch = numSwitch - numSwitch0;
+    includeCache.push(e);
+}
+
+// Tokenize the include files of all source files on the command line and save them in includeCache.
+// This is called before the files are assembled in separate processes, so that each process
+// gets a copy of the cache. The include directives are found by a simple search for lines
+// beginning with %include. A directive in a comment or a false condition is only tokenized
+// unnecessarily. Errors are not reported here. A file with errors is not saved, so that the
+// errors are reported by the process that assembles the file containing the directive
+void CAssembler::preloadIncludeFiles() {
+    CMemoryBuffer names;                         // paths of include files found so far
+    CDynamicArray<uint32_t> found;               // offsets into names
+    SToken nameToken = {0};                      // no token for error messages
+    SLine emptyLine = {0,0,0,0,0,0,0};
+    lines.push(emptyLine);                       // empty records for line 0, as in pass1
+    tokens.push(nameToken);
+    linei = 1;  filei = 1;  includeDepth = 0;  numSwitch = 0;
+    for (uint32_t f = 0; f < cmd.fileList.numEntries(); f++) {
+        const char * parent = cmd.getFilename(cmd.fileList[f].filename);
+        CFileBuffer source;
+        source.read(parent, CMDL_FILE_IN_IF_EXISTS);
+        const char * p = (const char *)source.buf();
+        const char * end = p + source.dataSize();
+        while (p < end) {
+            // search for: spaces % spaces include spaces "name"
+            while (p < end && (*p == ' ' || *p == '\t')) p++;
+            if (p < end && *p == '%') {
+                p++;
+                while (p < end && (*p == ' ' || *p == '\t')) p++;
+                if (end - p > 7 && strncasecmp_(p, "include", 7) == 0) {
+                    p += 7;
+                    while (p < end && (*p == ' ' || *p == '\t')) p++;
+                    const char * q = p + 1;
+                    while (q < end && *q != '"' && *q != '\n') q++;
+                    if (p < end && *p == '"' && q < end && *q == '"') {
+                        CMemoryBuffer name;
+                        includePath(name, parent, p + 1, uint32_t(q - p - 1));
+                        const char * fname = (const char *)name.buf();
+                        uint32_t i;
+                        for (i = 0; i < found.numEntries(); i++) {
+                            if (strcmp((const char *)names.buf() + found[i], fname) == 0) break;
+                        }
+                        if (i == found.numEntries()) {
+                            found.push(names.pushString(fname));
+                            includeFile(fname, nameToken, emptyLine);
+                        }
+                    }
+                }
+            }
+            // skip to next line
+            while (p < end && *p != '\n') p++;
+            p++;
+        }
+    }
+}
+
+// Name of source file or include file. file = SLine::file
+const char * CAssembler::fileName(uint32_t file) {
+    if (file >= 2 && file - 2 < includeFiles.numEntries()) {
+        return (const char *)includeNames.buf() + includeFiles[file - 2];
+    }
+    return cmd.getFilename(cmd.inputFile);
 }
 
 
@@ -890,34 +1178,77 @@ void CAssembler::interpretOptionsLine() {
 }
 
 
-// Find symbol by index into symbolNameBuffer. The return value is an index into symbols. 
-// Symbol indexes may change when new symbols are added to the symbols list, which is sorted by name
+// Hash value of symbol name for symbolHash. FNV-1a
+static inline uint32_t symbolNameHash(const char * name, uint32_t len) {
+    uint32_t h = 0x811C9DC5;
+    for (uint32_t i = 0; i < len; i++) h = (h ^ (uint8_t)name[i]) * 0x01000193;
+    return h;
+}
+
+// Find symbol by index into symbolNameBuffer. The return value is an index into symbols,
+// or negative if not found. 
+// Symbol indexes may change when the symbols list is sorted by name in pass 5
 uint32_t CAssembler::findSymbol(uint32_t namei) {
-    ElfFWC_Sym2 sym;                                       // temporary symbol record used for searching
-    sym.st_name = namei;
-    return symbols.findFirst(sym);                         // find symbol by name
+    const char * name = symbolNameBuffer.getString(namei);
+    return findSymbol(name, (uint32_t)strlen(name));
 } 
 
-// Find symbol by name as string. The return value is an index into symbols. 
-// Symbol indexes may change when new symbols are added to the symbols list, which is sorted by name
+// Find symbol by name as string. The return value is an index into symbols, or negative if not found. 
 uint32_t CAssembler::findSymbol(const char * name, uint32_t len) {
-    uint32_t saveSize = symbolNameBuffer.dataSize();       // save symbolNameBuffer size for later reset
-    uint32_t namei = symbolNameBuffer.putStringN(name, len); // put name temporarily into symbolNameBuffer
-    int32_t symi = findSymbol(namei);                      // find symbol by name index
-    symbolNameBuffer.setSize(saveSize);                    // remove temporary name from symbolNameBuffer
-    return symi;                                           // return symbol index
+    uint32_t size = symbolHash.numEntries();
+    if (size == 0) return 0x80000000;                      // no symbols
+    uint32_t h = symbolNameHash(name, len) & (size - 1);
+    while (symbolHash[h]) {                                // linear probing
+        uint32_t symi = symbolHash[h] - 1;
+        const char * s = symbolNameBuffer.getString(symbols[symi].st_name);
+        if (strncmp(s, name, len) == 0 && s[len] == 0) return symi;  // found
+        h = (h + 1) & (size - 1);
+    }
+    return 0x80000000;                                     // not found
+}
+
+// Insert symbol in symbolHash. The symbol must not be there already
+void CAssembler::symbolHashInsert(uint32_t symi) {
+    uint32_t size = symbolHash.numEntries();
+    if (symbols.numEntries() * 2 > size) {
+        symbolHashRebuild();                               // make table bigger. this includes the new symbol
+        return;
+    }
+    const char * name = symbolNameBuffer.getString(symbols[symi].st_name);
+    uint32_t h = symbolNameHash(name, (uint32_t)strlen(name)) & (size - 1);
+    while (symbolHash[h]) h = (h + 1) & (size - 1);
+    symbolHash[h] = symi + 1;
 }
 
-// Add a symbol to symbols list
+// Make symbolHash from symbols. Size is a power of 2, at least twice the number of symbols
+void CAssembler::symbolHashRebuild() {
+    uint32_t size = 1024;
+    while (size < symbols.numEntries() * 2) size <<= 1;
+    symbolHash.setNum(size);
+    symbolHash.zero();
+    for (uint32_t symi = 0; symi < symbols.numEntries(); symi++) {
+        if (symbols[symi].st_name) symbolHashInsert(symi);  // skip empty record
+    }
+}
+
+// Add a symbol to symbols list. Return 0 if already defined
 uint32_t CAssembler::addSymbol(ElfFWC_Sym2 & sym) {
-    int32_t f = symbols.findFirst(sym);
-    if (f >= 0) {
+    if ((int32_t)findSymbol(sym.st_name) >= 0) {
         // error: symbol already defined
         return 0;
     }
-    else {
-        return symbols.addUnique(sym);
-    }
+    return addUniqueSymbol(sym);
+}
+
+// Add a symbol to symbols list if a symbol with the same name is not already there.
+// Return the index of the new or existing symbol. New symbols are appended so that
+// existing symbol indexes do not change
+uint32_t CAssembler::addUniqueSymbol(ElfFWC_Sym2 & sym) {
+    int32_t symi = (int32_t)findSymbol(sym.st_name);
+    if (symi >= 0) return (uint32_t)symi;
+    symi = (int32_t)symbols.push(sym);
+    symbolHashInsert((uint32_t)symi);
+    return (uint32_t)symi;
 }
 
 // interpret   name: options {, name: options}
@@ -1136,7 +1467,7 @@ void CAssembler::interpretVariableDefinition1() {
             if (tokens[tok].type == TOK_NAM) { // name. make symbol
                 sym.st_name = symbolNameBuffer.putStringN((char*)buf()+tokens[tok].pos, tokens[tok].stringLength);
                 sym.st_type = STT_OBJECT;
-                symi = symbols.addUnique(sym);
+                symi = addUniqueSymbol(sym);
                 tokens[tok].type = TOK_SYM;      // change token type
                 tokens[tok].id = symbols[symi].st_name;  // use name offset as unique identifier because symbol index can change
                 state = 1;
@@ -1677,6 +2008,10 @@ void CAssembler::pass2() {
     zeroAllMembers(sym);              // reset symbol
     symbols.push(sym);                // symbol record 0 is empty
     symbolNameBuffer.put((char)0);    // put dummy zero to avoid zero offset at next string
+    SConstantExpression constant;     // constantExpressions record 0 is empty
+    zeroAllMembers(constant);
+    constantExpressions.push(constant);
+    constantTokens = tokens.numEntries();
     sectionFlags = 0;
     section = 0;
 
@@ -1884,19 +2219,148 @@ void CAssembler::initializeWordLists() {
     // Keywords list
     keywords.pushBig(keywordsList,sizeof(keywordsList));
     keywords.sort();
-    // Read instruction list from file
-    CCSVFile instructionListFile; 
-    instructionListFile.read(cmd.getFilename(cmd.instructionListFile), CMDL_FILE_SEARCH_PATH); // Filename of list of instructions
-    instructionListFile.parse();                            // Read and interpret instruction list file
-    instructionlist << instructionListFile.instructionlist; // Transfer instruction list to my own container
-    instructionlistId.copy(instructionlist);                // copy instruction list
-    instructionlistNm.copy(instructionlist);                // copy instruction list
-                                                            // sort lists by different criteria, defined by the different operators:
+    // Read instruction list from file or cache. The lists are sorted by different criteria, defined by the different operators:
     // operator < (SInstruction const & a, SInstruction const & b)
     // operator < (SInstruction3 const & a, SInstruction3 const & b)
-    SInstruction3 nullInstruction;                          // empty record
-    zeroAllMembers(nullInstruction);
-    instructionlistId.push(nullInstruction);                // Empty record will go to position 0 to avoid an instruction with index 0
-    instructionlistNm.sort();                               // Sort instructionlist by name
-    instructionlistId.sort();                               // Sort instructionlistId by id
+    CCSVFile instructionListFile; 
+    instructionListFile.load();                             // Read instruction list file or cache
+    instructionlist << instructionListFile.instructionlist; // Transfer instruction lists to my own containers
+    instructionlistNm << instructionListFile.instructionlistNm;
+    instructionlistId << instructionListFile.instructionlistId;
+    // Hash table for the tokenizer. It is included in the embedded instruction list
+    if (instructionListFile.reservedNames.numEntries()) {
+        reservedNames << instructionListFile.reservedNames;
+        reservedHash << instructionListFile.reservedHash;
+        reservedSeeds << instructionListFile.reservedSeeds;
+    }
+    else makeReservedNames(instructionlistNm, reservedNames, reservedHash, reservedSeeds);
+}
+
+// Hash value of reserved name. Case insensitive FNV-1a
+static inline uint64_t reservedNameHash(const char * name, uint32_t len) {
+    uint64_t h = 0xCBF29CE484222325;
+    for (uint32_t i = 0; i < len; i++) h = (h ^ (uint8_t)(name[i] | 0x20)) * 0x100000001B3;
+    return h;
+}
+
+// Position in reservedHash from hash value and bucket seed. Table size must be a power of 2
+static inline uint32_t reservedNamePosition(uint64_t h, uint32_t seed, uint32_t size) {
+    uint32_t x = (uint32_t)h ^ (seed * 0x9E3779B1);
+    x ^= x >> 16;  x *= 0x85EBCA6B;  x ^= x >> 13;
+    return x & (size - 1);
+}
+
+// Bucket of reserved name from hash value
+static inline uint32_t reservedNameBucket(uint64_t h, uint32_t numBuckets) {
+    return (uint32_t)(((h >> 32) * numBuckets) >> 32);
+}
+
+// Make perfect hash table of register names, keywords, and instruction names, so that the
+// tokenizer can classify a name with a single lookup.
+// A register name is a prefix from registerNames followed by a number 0-31 with one or two digits.
+// A name that is both a register name, a keyword, and an instruction name gets the first of these
+// meanings. The table is made by hash and displace: each name is assigned to a bucket, and each
+// bucket gets a seed that places all its names in vacant positions of the table. The biggest
+// buckets are placed first.
+// The table is made at startup, or by forw -ilisttable for instruction_table.h
+void makeReservedNames(CDynamicArray<SInstruction> & instructionlistNm, CDynamicArray<SReservedName> & reservedNames, CDynamicArray<uint16_t> & reservedHash, CDynamicArray<uint16_t> & reservedSeeds) {
+    CDynamicArray<SKeyword> keywords;            // keywords sorted by name
+    keywords.pushBig(keywordsList, sizeof(keywordsList));
+    keywords.sort();
+    SReservedName rec;
+    uint32_t i, k, num;
+    zeroAllMembers(rec);
+    // register names
+    rec.type = TOK_REG;
+    for (i = 0; i < TableSize(registerNames); i++) {
+        for (num = 0; num < 32 + 10; num++) {
+            if (num < 32) snprintf(rec.name, sizeof(rec.name), "%.27s%u", registerNames[i].name, num);
+            else snprintf(rec.name, sizeof(rec.name), "%.27s0%u", registerNames[i].name, num - 32);  // r00 - r09
+            rec.length = (uint32_t)strlen(rec.name);
+            rec.id = registerNames[i].id + (num < 32 ? num : num - 32);
+            reservedNames.push(rec);
+        }
+    }
+    // keywords
+    for (i = 0; i < keywords.numEntries(); i++) {
+        zeroAllMembers(rec);
+        strcpy(rec.name, keywords[i].name);
+        rec.length = (uint32_t)strlen(rec.name);
+        rec.id = keywords[i].id;
+        rec.type = keywords[i].id >> 24;
+        reservedNames.push(rec);
+    }
+    // instruction names. the first record with each name
+    for (i = 0; i < instructionlistNm.numEntries(); i++) {
+        if (i > 0 && !(instructionlistNm[i-1] < instructionlistNm[i])) continue;
+        zeroAllMembers(rec);
+        strcpy(rec.name, instructionlistNm[i].name);
+        rec.length = (uint32_t)strlen(rec.name);
+        rec.id = instructionlistNm[i].id;
+        rec.type = TOK_INS;
+        reservedNames.push(rec);
+    }
+
+    // assign names to buckets
+    uint32_t numBuckets = (reservedNames.numEntries() + 3) / 4;
+    CDynamicArray<uint32_t> bucketOf;            // bucket of each name
+    CDynamicArray<uint32_t> bucketSize;          // number of names in each bucket
+    CDynamicArray<uint32_t> placed;              // table positions used in current attempt
+    bucketSize.setNum(numBuckets);
+    uint32_t maxSize = 0, b, seed, size, done;
+    for (k = 0; k < reservedNames.numEntries(); k++) {
+        b = reservedNameBucket(reservedNameHash(reservedNames[k].name, reservedNames[k].length), numBuckets);
+        bucketOf.push(b);
+        if (++bucketSize[b] > maxSize) maxSize = bucketSize[b];
+    }
+    reservedSeeds.setNum(numBuckets);
+    uint32_t tableSize = 16;
+    while (tableSize < reservedNames.numEntries() * 2) tableSize <<= 1;
+    while (true) {
+        reservedHash.setNum(tableSize);
+        reservedHash.zero();
+        for (size = maxSize; size > 0; size--) {
+            for (b = 0; b < numBuckets; b++) {
+                if (bucketSize[b] != size) continue;
+                for (seed = 0; seed < 0x10000; seed++) {
+                    // try to place all names in bucket with this seed
+                    placed.setSize(0);
+                    for (k = 0, done = 0; k < reservedNames.numEntries(); k++) {
+                        if (bucketOf[k] != b) continue;
+                        SReservedName & r = reservedNames[k];
+                        uint32_t pos = reservedNamePosition(reservedNameHash(r.name, r.length), seed, tableSize);
+                        if (reservedHash[pos]) {
+                            // occupied. a name that is already placed with another meaning is skipped
+                            SReservedName & r2 = reservedNames[reservedHash[pos] - 1];
+                            if (r2.length == r.length && strncasecmp_(r2.name, r.name, r.length) == 0) {
+                                done++;  continue;
+                            }
+                            break;
+                        }
+                        reservedHash[pos] = uint16_t(k + 1);
+                        placed.push(pos);  done++;
+                    }
+                    if (done == size) break;                // success
+                    for (k = 0; k < placed.numEntries(); k++) reservedHash[placed[k]] = 0;  // undo
+                }
+                if (seed >= 0x10000) break;                 // failed
+                reservedSeeds[b] = (uint16_t)seed;
+            }
+            if (b < numBuckets) break;                      // failed
+        }
+        if (size == 0) break;                               // all buckets placed
+        tableSize <<= 1;                                    // failed. try a bigger table
+    }
+}
+
+// Find register name, keyword, or instruction name. Returns index into reservedNames, or -1 if not found
+int32_t CAssembler::findReservedName(const char * name, uint32_t len) {
+    if (len > maxINameLen) return -1;
+    uint64_t h = reservedNameHash(name, len);
+    uint32_t b = reservedNameBucket(h, reservedSeeds.numEntries());
+    uint32_t i = reservedHash[reservedNamePosition(h, reservedSeeds[b], reservedHash.numEntries())];
+    if (i == 0) return -1;
+    SReservedName & r = reservedNames[i-1];
+    if (r.length != len || strncasecmp_(r.name, name, len) != 0) return -1;
+    return int32_t(i - 1);
 }
@@ -26,10 +26,14 @@ SExpression CAssembler::expression(uint32_t tok1, uint32_t maxtok, uint32_t opti
     // 8: inside {}. has no meaning yet
     // 0x10: check syntax and count tokens, but do not call functions or report numeric 
     //       overflow, wrong operand types, or unknown names
+    // 0x20: subexpression of an expression that contains only numbers and operators
 
     // This function scans the tokens and finds the operator with lowest priority. 
     // The function is called recursively for each operand to this operator.
     // The level of parantheses is saved in the brackets stack.
+    // The value of a subexpression containing only numbers and operators is saved in
+    // constantExpressions so that it is not parsed and evaluated again in the next pass.
+    // Only subexpressions containing symbols are evaluated again.
     // The scanning terminates at any of these conditions:
     // * a token that cannot be part of the expression is encountered
     // * all tokens are used
@@ -49,6 +53,17 @@ SExpression CAssembler::expression(uint32_t tok1, uint32_t maxtok, uint32_t opti
     int32_t  symi;                // symbol index
     bool     is_local = false;    // symbol is local constant
     uint8_t  endbracket;          // expected end bracket
+    bool     literal = true;      // expression contains only numbers and operators
+    bool     save = false;        // save value of expression in constantExpressions
+
+    if (tok1 < constantTokens && !(options & 0x20) && !lineError) {
+        // search for the same expression evaluated before
+        for (i = tokens[tok1].constants; i; i = constantExpressions[i].next) {
+            if (constantExpressions[i].maxtok == maxtok && constantExpressions[i].options == (options & ~0x30)) {
+                return constantExpressions[i].expr;
+            }
+        }
+    }
 
     SExpression exp1, exp2;       // expressions during evaluation
     zeroAllMembers(exp1);         // reset exp1
@@ -127,6 +142,9 @@ SExpression CAssembler::expression(uint32_t tok1, uint32_t maxtok, uint32_t opti
         }
         else {
             // not an operator
+            if (tokens[tok].type != TOK_NUM && tokens[tok].type != TOK_FLT && tokens[tok].type != TOK_CHA) {
+                literal = false;  // value may change
+            }
             if (bracketlevel) continue;  // inside brackets: search only for end bracket
             if (state == 0) {
                 // expecting value
@@ -172,6 +190,13 @@ SExpression CAssembler::expression(uint32_t tok1, uint32_t maxtok, uint32_t opti
         errors.report(tokens[tok].pos, tokens[tok].stringLength, ERR_MISSING_EXPR);
         return exp1;
     }
+    if (literal && !(options & 0x20)) {
+        // constant expression. save the value of the whole expression, not the subexpressions.
+        // expressions in code lines are evaluated only in pass 3, data and meta code also in pass 2.
+        // a single number is not saved because it is interpreted again faster than it is looked up
+        save = pass < 3 && tok1 < constantTokens && ntok > 1;
+        options |= 0x20;
+    }
 
     switch (priority) {
     case 0:  // no operator found. just an expression
@@ -463,6 +488,16 @@ DYADIC:
     if (exp1.etype & XPR_ERROR) {
         errors.report(tokens[toklow].pos, tokens[toklow].stringLength, exp1.value.w);
     }
+    else if (save) {
+        // remember value of constant expression
+        SConstantExpression constant;
+        constant.expr = exp1;
+        constant.maxtok = maxtok;
+        constant.options = options & ~0x30;
+        constant.next = tokens[tok1].constants;
+        constant.unused = 0;
+        tokens[tok1].constants = constantExpressions.push(constant);
+    }
     return exp1;
 }
 
@@ -176,7 +176,7 @@ void CAssembler::interpretMetaDefinition() {
             if (state == 0) break;
             if (state >= 3) { errors.report(tokens[tok]);  break; }
             sym.st_name = symbolNameBuffer.putStringN((char*)buf() + tokens[tok].pos, tokens[tok].stringLength);
-            symi = symbols.addUnique(sym);
+            symi = addUniqueSymbol(sym);
             symbols[symi].st_type = 0;  // remember that symbol has no value yet
             symbols[symi].st_section = SECTION_LOCAL_VAR;  // remember symbol is not external. use arbitrary section
             symbols[symi].st_unitsize = 8;
@@ -22,6 +22,15 @@ void CAssembler::pass3() {
     data_size = cmd.dataSizeOption;
     section = 0;
     iLoop = iIf = iSwitch = 0;         // index of current high level statements
+
+    // reserve space for code records. most code lines make one instruction
+    uint32_t numCodeLines = 0;
+    for (linei = 1; linei < lines.numEntries(); linei++) {
+        if (lines[linei].type == LINE_CODEDEF) numCodeLines++;
+    }
+    codeBuffer.setSize((codeBuffer.numEntries() + numCodeLines) * (uint32_t)sizeof(SCode));
+    bool incremental = (cmd.assembleOptions & CMDL_ASM_INCREMENTAL) != 0;
+    if (incremental) functionCacheLoad();        // code of functions from the previous run
     
     // lines loop
     for (linei = 1; linei < lines.numEntries()-1; linei++) {
@@ -48,11 +57,17 @@ void CAssembler::pass3() {
             continue;
         case LINE_FUNCTION:
             interpretFunctionDirective();
+            if (incremental && functionCacheBegin()) {
+                // the code of the function has been taken from the cache. continue at the end directive
+                last_line_type = LINE_CODEDEF;
+                continue;
+            }
             break;
         case LINE_SECTION:
             interpretSectionDirective();
             break;
         case LINE_ENDDIR:
+            if (functionRecord.endLine == linei) functionCacheSave();
             interpretEndDirective();
             break;
         case LINE_OPTIONS:
@@ -78,6 +93,386 @@ void CAssembler::makeFormatLists() {
     }
 }
 
+// continue a hash with one 64-bit word
+static inline uint64_t hashWord(uint64_t hash, uint64_t word) {
+    hash = (hash ^ word) * 0x9E3779B97F4A7C15;
+    return hash ^ (hash >> 29);
+}
+
+// continue a hash with a block of data
+static uint64_t hashMore(uint64_t hash, const void * p, uint32_t size) {
+    const int8_t * q = (const int8_t *)p;
+    uint64_t word;
+    for (; size >= 8; size -= 8, q += 8) {
+        memcpy(&word, q, 8);
+        hash = hashWord(hash, word);
+    }
+    word = (uint64_t)size << 56;                 // last 0-7 bytes and their number
+    memcpy(&word, q, size);
+    return hashWord(hash, word);
+}
+
+// name of function cache file = object file name + ".cache"
+static void functionCacheName(CMemoryBuffer & name) {
+    const char * objectName = cmd.getFilename(cmd.outputFile);
+    name.push(objectName, (uint32_t)strlen(objectName));
+    name.pushString(".cache");
+}
+
+// Hash of the options, instruction list, and formats that the cached code records depend on
+uint64_t CAssembler::functionCacheEnvironment() {
+    uint64_t options[5] = {sizeof(SCode), sizeof(SFunctionCacheSymbol), (uint64_t)cmd.optiLevel, cmd.codeSizeOption, cmd.dataSizeOption};
+    uint64_t hash = hashMore(0, options, sizeof(options));
+    hash = hashMore(hash, instructionlistId.buf(), instructionlistId.dataSize());
+    return hashMore(hash, formatList, formatListSize * (uint32_t)sizeof(SFormat));
+}
+
+// Read the cache file with the code records of each function from the previous run, for the -incremental option.
+// The file is ignored if it is made with other options or another instruction list
+void CAssembler::functionCacheLoad() {
+    functionCacheNew = 0;
+    CMemoryBuffer name;
+    functionCacheName(name);
+    oldFunctionCache.read(name.getString(0), CMDL_FILE_IN_IF_EXISTS);
+    uint32_t size = oldFunctionCache.dataSize();
+    if (size < sizeof(SFunctionCacheHeader) || size >= 0x80000000) return;
+    SFunctionCacheHeader & header = *(SFunctionCacheHeader*)oldFunctionCache.buf();
+    if (strcmp(header.signature, "FWCFUNC") != 0 || header.environment != functionCacheEnvironment() || header.numFunctions > size) {
+        header.numFunctions = 0;
+        return;
+    }
+    // make hash table of function blocks
+    uint32_t n = 16;
+    while (n < header.numFunctions * 2) n <<= 1;
+    oldFunctionHash.setNum(n);
+    uint32_t offset = sizeof(SFunctionCacheHeader);
+    for (uint32_t i = 0; i < header.numFunctions; i++) {
+        if (offset + sizeof(SFunctionCache) > size) break;
+        SFunctionCache const & f = *(SFunctionCache const *)(oldFunctionCache.buf() + offset);
+        if (f.size < sizeof(SFunctionCache) || (f.size & 7) || f.size > size - offset) break;   // damaged file
+        uint32_t h = uint32_t(f.key >> 32) & (n - 1);
+        while (oldFunctionHash[h]) h = (h + 1) & (n - 1);    // linear probing
+        oldFunctionHash[h] = offset;
+        offset += f.size;
+    }
+}
+
+// Hash of the lines of the function with the function directive in line. endLine gets the line of the end directive.
+// Returns 0 if the function cannot be cached because it contains other lines than code, or meta variables with symbols or strings
+uint64_t CAssembler::functionHash(uint32_t line, uint32_t & endLine) {
+    uint64_t hash = 0;
+    uint32_t numCodeLines = 0;
+    uint32_t li, tok;
+    for (li = line + 1; li < lines.numEntries(); li++) {
+        uint32_t tokB = lines[li].firstToken, tokN = lines[li].numTokens;
+        if (tokN == 0) continue;
+        bool codeLine = lines[li].type == LINE_CODEDEF;
+        if (!codeLine && lines[li].type != LINE_ENDDIR) return 0;
+        // text of line and its position relative to the function directive
+        uint32_t end = tokens[tokB + tokN - 1].pos + tokens[tokB + tokN - 1].stringLength;
+        hash = hashWord(hash, li - line);
+        hash = hashMore(hash, buf() + tokens[tokB].pos, end - tokens[tokB].pos);
+        // types of tokens and values of meta variables saved in pass 2
+        for (tok = tokB; tok < tokB + tokN; tok++) {
+            SToken const & t = tokens[tok];
+            hash = hashWord(hash, t.type | (uint64_t)t.vartype << 32);
+            if (t.type == TOK_XPR) {
+                SExpression const & x = expressions[t.value.w];
+                if ((x.sym1 | x.sym2 | x.sym3 | x.sym4 | x.sym5) || (x.etype & XPR_STRING)) return 0;
+                hash = hashWord(hash, x.value.u);
+                hash = hashWord(hash, (uint32_t)x.offset_mem | (uint64_t)(uint32_t)x.offset_jump << 32);
+                hash = hashWord(hash, x.etype | (uint64_t)x.instruction << 32);
+                hash = hashMore(hash, &x.optionbits, uint32_t(&x.fallback + 1 - &x.optionbits));
+            }
+            else if (t.vartype || t.type == TOK_TYP) {
+                hash = hashWord(hash, t.value.u);
+            }
+        }
+        if (!codeLine) break;                    // end directive
+        numCodeLines++;
+    }
+    endLine = li;
+    if (numCodeLines == 0 || li >= lines.numEntries()) return 0;
+    return hash;
+}
+
+// Called after the function directive in linei in pass 3 with the -incremental option.
+// Use the code records of the function from the previous run if the function and everything 
+// it depends on is unchanged. Otherwise, start recording the function for the next run.
+// Returns true if the code records have been taken from the cache. linei is then before the end directive
+bool CAssembler::functionCacheBegin() {
+    functionRecord.endLine = 0;
+    functionLabels.setNum(0);
+    uint32_t endLine = 0;
+    uint64_t key = functionHash(linei, endLine);
+    // the preceding code record must be the label record made by interpretFunctionDirective, 
+    // so that the first instruction cannot be merged with an instruction before the function
+    if (key == 0 || section == 0 || hllBlocks.numEntries() || codeBuffer.numEntries() == 0 
+    || codeBuffer[codeBuffer.numEntries()-1].instruction) return false;
+    ElfFwcShdr const & sheader = sectionHeaders[section];
+    uint64_t state[7] = {section | (uint64_t)sheader.sh_flags << 32, sheader.sh_size, sheader.sh_link, code_size, data_size,
+        iLoop | (uint64_t)iIf << 32, iSwitch | (uint64_t)numSwitch << 32};
+    key = hashMore(key, state, sizeof(state));
+
+    // search for the function in the cache from the previous run
+    uint32_t n = oldFunctionHash.numEntries();
+    for (uint32_t h = uint32_t(key >> 32) & (n - 1); n && oldFunctionHash[h]; h = (h + 1) & (n - 1)) {
+        uint32_t offset = oldFunctionHash[h];
+        if (oldFunctionCache.get<SFunctionCache>(offset).key == key && functionCacheUse(offset, endLine)) return true;
+    }
+    // interpret the function and save it for the next run
+    functionRecord.key = key;
+    functionRecord.line = linei;
+    functionRecord.endLine = endLine;
+    functionRecord.firstCode = codeBuffer.numEntries();
+    functionRecord.numErrors = errors.numErrors();
+    functionRecord.numSymbols = symbols.numEntries();
+    functionRecord.numCodes2 = codeBuffer2.numEntries();
+    return false;
+}
+
+// Use the code records of the function block at offset in the cache from the previous run,
+// if the symbols it depends on are unchanged
+bool CAssembler::functionCacheUse(uint32_t offset, uint32_t endLine) {
+    SFunctionCache const & f = oldFunctionCache.get<SFunctionCache>(offset);
+    int8_t const * p = oldFunctionCache.buf() + offset + sizeof(SFunctionCache);
+    int8_t const * blockEnd = oldFunctionCache.buf() + offset + f.size;
+    if (f.numSymbols > f.size / sizeof(SFunctionCacheSymbol) 
+    || f.namesSize > uint32_t(blockEnd - p) - f.numSymbols * sizeof(SFunctionCacheSymbol)) return false;  // damaged file
+    SFunctionCacheSymbol const * syms = (SFunctionCacheSymbol const *)p;
+    const char * names = (const char *)p + f.numSymbols * sizeof(SFunctionCacheSymbol);
+    p = (int8_t const *)names + f.namesSize;
+    uint32_t i, j;
+
+    // find the symbols and check that they are unchanged. Symbols made by the function must not exist yet
+    CDynamicArray<uint32_t> symIndex;            // index into symbols for each cached symbol
+    symIndex.setNum(f.numSymbols);
+    if (f.namesSize && names[f.namesSize-1] != 0) return false;
+    for (i = 0; i < f.numSymbols; i++) {
+        ElfFwcSym const & s = syms[i].sym;
+        if (s.st_name >= f.namesSize) return false;
+        const char * name = names + s.st_name;
+        uint32_t symi = syms[i].symIndex;
+        if (syms[i].made || symi >= symbols.numEntries() || strcmp(symbolNameBuffer.getString(symbols[symi].st_name), name) != 0) {
+            symi = findSymbol(name, (uint32_t)strlen(name));
+        }
+        if (syms[i].made) {
+            if (int32_t(symi) >= 0) return false;
+            continue;
+        }
+        if (int32_t(symi) <= 0) return false;
+        ElfFWC_Sym2 const & sym = symbols[symi];
+        if (sym.st_type != s.st_type || sym.st_bind != s.st_bind || sym.st_other != s.st_other 
+        || sym.st_section != s.st_section || sym.st_value != s.st_value || sym.st_unitsize != s.st_unitsize 
+        || sym.st_unitnum != s.st_unitnum || sym.st_reguse1 != s.st_reguse1 || sym.st_reguse2 != s.st_reguse2) return false;
+        uint32_t sectionFlags = sym.st_section < sectionHeaders.numEntries() ? sectionHeaders[sym.st_section].sh_flags : 0;
+        if (sectionFlags != syms[i].sectionFlags) return false;
+        symIndex[i] = symi;
+    }
+    // decompress the code records
+    uint32_t firstCode = codeBuffer.numEntries();
+    SCode code;
+    uint32_t * words = (uint32_t *)&code;
+    for (i = 0; i < f.numCodes; i++) {
+        uint64_t mask;
+        if (p + 8 > blockEnd) break;
+        memcpy(&mask, p, 8);  p += 8;
+        zeroAllMembers(code);
+        for (j = 0; j < sizeof(SCode) / 4 && mask; j++, mask >>= 1) {
+            if (!(mask & 1)) continue;
+            if (p + 4 > blockEnd) break;
+            memcpy(words + j, p, 4);  p += 4;
+        }
+        // line and format of this run. symbols are translated below when the made symbols exist
+        uint32_t * codeNames[6] = {&code.label, &code.sym1, &code.sym2, &code.sym3, &code.sym4, &code.sym5};
+        bool ok = mask == 0 && code.line < endLine - linei && code.instr1 < instructionlistId.numEntries();
+        for (j = 0; j < 6; j++) {
+            if (*codeNames[j] > f.numSymbols) ok = false;
+        }
+        if (code.line) code.line += linei;
+        uint32_t format = (uint32_t)(size_t)code.formatp;
+        if (format == 0) code.formatp = 0;
+        else if (format - 1 < formatListSize) code.formatp = formatList + (format - 1);
+        else if (format - 0x10001 < formatList3.numEntries()) code.formatp = &formatList3[format - 0x10001];
+        else if (format - 0x20001 < formatList4.numEntries()) code.formatp = &formatList4[format - 0x20001];
+        else ok = false;
+        if (!ok) break;
+        codeBuffer.push(code);
+    }
+    if (i < f.numCodes) {                        // damaged file
+        codeBuffer.setNum(firstCode);
+        return false;
+    }
+    // make the symbols that the function makes, and give labels defined in the function their section
+    for (i = 0; i < f.numSymbols; i++) {
+        if (syms[i].made) {
+            ElfFWC_Sym2 sym;
+            zeroAllMembers(sym);
+            *(ElfFwcSym*)&sym = syms[i].sym;
+            const char * name = names + syms[i].sym.st_name;
+            sym.st_name = symbolNameBuffer.putStringN(name, (uint32_t)strlen(name));
+            symIndex[i] = addSymbol(sym);
+        }
+        symbols[symIndex[i]].st_section = syms[i].sectionAfter;
+    }
+    for (i = firstCode; i < codeBuffer.numEntries(); i++) {
+        uint32_t * codeNames[6] = {&codeBuffer[i].label, &codeBuffer[i].sym1, &codeBuffer[i].sym2, &codeBuffer[i].sym3, &codeBuffer[i].sym4, &codeBuffer[i].sym5};
+        for (j = 0; j < 6; j++) {
+            if (*codeNames[j]) *codeNames[j] = symbols[symIndex[*codeNames[j] - 1]].st_name;
+        }
+    }
+    iLoop = f.iLoop;  iIf = f.iIf;
+    iSwitch = f.iSwitch;  numSwitch = f.numSwitch;
+
+    // keep the function in the cache for the next run
+    functionCacheBlocks.push(offset);
+    linei = endLine - 1;
+    return true;
+}
+
+// Add the symbol with the specified name to the symbols that the function being saved depends on or makes.
+// Returns index into the symbols of the function + 1, or 0 if there is no such symbol
+uint32_t CAssembler::functionCacheSymbol(uint32_t name) {
+    // most names are used more than once. look in the memo before searching by name
+    uint32_t & memo = functionNameMemo[(name * 0x9E3779B1u) >> 22];
+    uint32_t symi = memo - 1;
+    if (memo == 0 || symbols[symi].st_name != name) {
+        symi = findSymbol(name);
+        if (int32_t(symi) <= 0) return 0;
+        memo = symi + 1;
+    }
+    if (functionSymbols[symi] == 0) {
+        SFunctionCacheSymbol s;
+        zeroAllMembers(s);
+        s.sym = symbols[symi];
+        s.sym.st_name = functionCacheNames.pushString(symbolNameBuffer.getString(symbols[symi].st_name));
+        s.symIndex = symi;
+        s.made = symi >= functionRecord.numSymbols;
+        functionSymbols[symi] = functionCacheSymbols.push(s) + 1;
+    }
+    return functionSymbols[symi];
+}
+
+// Save the code records of the function that has been recorded since functionCacheBegin, for the next run. 
+// linei is at the end directive. Functions with errors or unfinished high level blocks are not saved
+void CAssembler::functionCacheSave() {
+    SFunctionRecord & r = functionRecord;
+    r.endLine = 0;
+    if (errors.numErrors() != r.numErrors || codeBuffer2.numEntries() != r.numCodes2
+    || hllBlocks.numEntries() || codeBuffer.numEntries() < r.firstCode) return;
+
+    functionCacheSymbols.setNum(0);
+    functionCacheNames.setSize(0);
+    functionCacheCodes.setSize(0);
+    if (functionSymbols.numEntries() < symbols.numEntries()) functionSymbols.setNum(symbols.numEntries());
+    if (functionNameMemo.numEntries() == 0) functionNameMemo.setNum(1024);
+    bool ok = true;
+    uint32_t i, j, tok;
+    SFormat const * list3 = (SFormat const *)formatList3.buf();
+    SFormat const * list4 = (SFormat const *)formatList4.buf();
+
+    // symbols made by high level statements in the function, in the order they were made
+    for (i = r.numSymbols; i < symbols.numEntries(); i++) {
+        if (functionCacheSymbol(symbols[i].st_name) == 0) ok = false;
+    }
+    // symbols in the lines of the function, including constants that have been replaced by their value
+    for (i = r.line + 1; i < linei; i++) {
+        for (tok = lines[i].firstToken; tok < lines[i].firstToken + lines[i].numTokens; tok++) {
+            if (tokens[tok].type == TOK_SYM && functionCacheSymbol(tokens[tok].id) == 0) ok = false;
+        }
+    }
+    // code records with symbols, line numbers, and formats replaced by index, compressed
+    for (i = r.firstCode; i < codeBuffer.numEntries() && ok; i++) {
+        SCode code = codeBuffer[i];
+        uint32_t * codeNames[6] = {&code.label, &code.sym1, &code.sym2, &code.sym3, &code.sym4, &code.sym5};
+        for (j = 0; j < 6; j++) {
+            if (*codeNames[j]) {
+                *codeNames[j] = functionCacheSymbol(*codeNames[j]);
+                if (*codeNames[j] == 0) ok = false;
+            }
+        }
+        if (code.line) code.line -= r.line;
+        uint32_t format = 0;
+        if (code.formatp >= formatList && code.formatp < formatList + formatListSize) format = uint32_t(code.formatp - formatList) + 1;
+        else if (code.formatp >= list3 && code.formatp < list3 + formatList3.numEntries()) format = uint32_t(code.formatp - list3) + 0x10001;
+        else if (code.formatp >= list4 && code.formatp < list4 + formatList4.numEntries()) format = uint32_t(code.formatp - list4) + 0x20001;
+        else if (code.formatp) ok = false;
+        code.formatp = (SFormat const *)(size_t)format;
+        uint32_t words[sizeof(SCode) / 4];
+        memcpy(words, &code, sizeof(SCode));
+        uint32_t packed[2 + sizeof(SCode) / 4];  // mask and nonzero words
+        uint64_t mask = 0;
+        uint32_t n = 2;
+        for (j = 0; j < sizeof(SCode) / 4; j++) {
+            if (words[j]) {
+                mask |= (uint64_t)1 << j;
+                packed[n++] = words[j];
+            }
+        }
+        memcpy(packed, &mask, 8);
+        functionCacheCodes.push(packed, n * 4);
+    }
+    // the symbols as they were before the function. labels in the function may have got a new st_section
+    for (i = functionLabels.numEntries(); i >= 2; i -= 2) {
+        j = functionSymbols[functionLabels[i-2]];
+        if (j && !functionCacheSymbols[j-1].made) functionCacheSymbols[j-1].sym.st_section = functionLabels[i-1];
+    }
+    for (i = 0; i < functionCacheSymbols.numEntries(); i++) {
+        SFunctionCacheSymbol & s = functionCacheSymbols[i];
+        functionSymbols[s.symIndex] = 0;
+        s.sectionAfter = symbols[s.symIndex].st_section;
+        s.sectionFlags = s.sym.st_section < sectionHeaders.numEntries() ? sectionHeaders[s.sym.st_section].sh_flags : 0;
+    }
+    if (!ok) return;
+
+    // add the block for this function to the cache
+    SFunctionCache f;
+    zeroAllMembers(f);
+    f.key = r.key;
+    f.numCodes = codeBuffer.numEntries() - r.firstCode;
+    f.numSymbols = functionCacheSymbols.numEntries();
+    static const int8_t zeroes[8] = {0};         // alignment to 8. push(0, size) does not clear space that has been used before
+    if (functionCacheNames.dataSize() & 7) functionCacheNames.push(zeroes, -functionCacheNames.dataSize() & 7);
+    if (functionCacheCodes.dataSize() & 7) functionCacheCodes.push(zeroes, -functionCacheCodes.dataSize() & 7);
+    f.namesSize = functionCacheNames.dataSize();
+    f.size = uint32_t(sizeof(SFunctionCache) + functionCacheSymbols.dataSize() + f.namesSize + functionCacheCodes.dataSize());
+    f.iLoop = iLoop;  f.iIf = iIf;
+    f.iSwitch = iSwitch;  f.numSwitch = numSwitch;
+    if (functionCache.dataSize() + f.size > functionCache.bufferSize() && functionCacheBlocks.numEntries() == functionCacheNew) {
+        // no function has been reused. reserve space for the rest of the file at the size per line of this function
+        functionCache.setSize(functionCache.dataSize() + f.size + uint32_t((uint64_t)f.size * (lines.numEntries() - linei) / (linei - r.line)));
+    }
+    functionCacheBlocks.push(functionCache.push(&f, sizeof(f)) | 0x80000000);
+    CMemoryBuffer * parts[3] = {&functionCacheSymbols, &functionCacheNames, &functionCacheCodes};
+    for (i = 0; i < 3; i++) {
+        if (parts[i]->dataSize()) functionCache.push(parts[i]->buf(), parts[i]->dataSize());
+    }
+    functionCacheNew++;
+}
+
+// Write the cache file with the code records of each function for the next run with the -incremental option.
+// The file is not written if all functions were taken from it. Failure is ignored
+void CAssembler::functionCacheWrite() {
+    if (functionCacheNew == 0 && oldFunctionCache.dataSize() >= sizeof(SFunctionCacheHeader)
+    && oldFunctionCache.get<SFunctionCacheHeader>(0).numFunctions == functionCacheBlocks.numEntries()) return;
+    SFunctionCacheHeader header;
+    zeroAllMembers(header);
+    strcpy(header.signature, "FWCFUNC");
+    header.environment = functionCacheEnvironment();
+    header.numFunctions = functionCacheBlocks.numEntries();
+    CFileBuffer cache;
+    cache.push(&header, sizeof(header));
+    for (uint32_t i = 0; i < functionCacheBlocks.numEntries(); i++) {
+        uint32_t offset = functionCacheBlocks[i];
+        CMemoryBuffer & blocks = (offset & 0x80000000) ? functionCache : oldFunctionCache;
+        SFunctionCache const & block = blocks.get<SFunctionCache>(offset & 0x7FFFFFFF);
+        cache.push(&block, block.size);
+    }
+    CMemoryBuffer name;
+    functionCacheName(name);
+    cache.writeReplace(name.getString(0));       // another process cannot see a half-written file
+}
+
 // Interpret a line defining code. This covers both assembly style and high level style code
 void CAssembler::interpretCodeLine() {
     uint32_t tok;                                // token index
@@ -224,7 +619,12 @@ void CAssembler::interpretCodeLine() {
                     code.label = token.id;
                     if (code.label) {
                         int32_t symi = findSymbol(code.label);
-                        if (symi > 0) symbols[symi].st_section = section;
+                        if (symi > 0) {
+                            if (functionRecord.endLine) {  // remember st_section before the function for the function cache
+                                functionLabels.push(symi);  functionLabels.push(symbols[symi].st_section);
+                            }
+                            symbols[symi].st_section = section;
+                        }
                     }
                     state = 1;
                 }
@@ -1012,6 +1412,29 @@ int CAssembler::fitCode(SCode & code) {
     }
     if (lineError) return 0;
 
+    // The best variant and format depend only on the operands, not on the position and the symbol names.
+    // Use the result of a previous search for the same operands if possible
+    SFitCache key;
+    SFitCache & cached = fitCacheFind(code, key, instrIndex, nInstr);
+    if (cached.instr) {
+        // make the same changes to code as the loop below does up to the cached variant
+        for (ii = instrIndex; ii <= cached.instr; ii++) {
+            variant = instructionlistId[ii].variant;
+            if ((variant & VARIANT_U3) && (code.dtype & TYP_UNS) && ii != II_COMPARE) {
+                code.optionbits |= 8;  // unsigned min, max
+                code.etype |= XPR_OPTIONS;
+            }
+        }
+        bestInstr = cached.instr;
+        code.instr1 = bestInstr;
+        code.category = instructionlistId[bestInstr].category;
+        code.formatp = cached.formatp;
+        if (code.category == 4) jumpInstructionFits(code, codeBest, bestInstr);
+        else instructionFits(code, codeBest, bestInstr);
+        bestSize = codeBest.size;
+        nInstr = 0;                              // skip search
+    }
+
     // loop through all instruction definitions with same id
     for (ii = instrIndex; ii < instrIndex + nInstr; ii++) {
         // category
@@ -1084,6 +1507,13 @@ int CAssembler::fitCode(SCode & code) {
         errors.reportLine(checkCodeE(code));         // find reason why no format fits, and report error
         return 0;
     }
+    if (!cached.instr && &cached != &key) {
+        // save result in fitCache
+        key.instr = bestInstr;
+        key.formatp = codeBest.formatp;
+        cached = key;
+        fitCacheNum++;
+    }
 
     code = codeBest;          // get the best fitting code
     variant = instructionlistId[bestInstr].variant;  // instruction-specific variants
@@ -1095,6 +1525,82 @@ int CAssembler::fitCode(SCode & code) {
 }
 
 
+// Find entry in fitCache for code with the same operands. Returns a vacant entry if not found.
+// key gets the properties of the code that the fit depends on. The values of constants and
+// offsets are reduced to the few ranges that some formats and instruction variants check.
+// instrIndex, nInstr: the variants of the instruction in instructionlistId.
+// Returns key itself if the code cannot be cached
+SFitCache & CAssembler::fitCacheFind(SCode const & code, SFitCache & key, uint32_t instrIndex, uint32_t nInstr) {
+    zeroAllMembers(key);
+    if (nInstr > 32) return key;                 // too many variants for the bits in key.values
+    key.instruction = code.instruction;
+    key.etype = code.etype;
+    key.dtype = code.dtype;
+    key.fitNum = code.fitNum;
+    key.fitAddr = code.fitAddr;
+    key.fitJump = code.fitJump;
+    // register classes and the relations between registers that decide the number of register operands
+    key.registers = code.dest >> 5 | (code.reg1 >> 5) << 3 | (code.reg2 >> 5) << 6 | (code.reg3 >> 5) << 9
+        | (code.dest != 0) << 12 | (code.reg1 == code.dest) << 13 
+        | ((code.fallback & 0x1F) == (code.reg1 & 0x1F)) << 14 | ((code.reg1 & 0x1F) == 0x1F) << 15
+        | ((code.base & 0x1F) >= 0x1C && (code.base & 0x1F) != 0x1F) << 16
+        | (code.optionbits != 0) << 17 | (code.sym1 != 0) << 18 | uint32_t(uint8_t(code.scale)) << 24;
+    // ranges checked by instructionFits and jumpInstructionFits
+    uint64_t v = 0;
+    if (value0 < 0x100 && value0 > -(int64_t)0x80U) v |= 1;                 // OPI_UINT8
+    if (value0 < 0x10000 && value0 > -(int64_t)0x8000U) v |= 2;             // OPI_UINT16
+    if (value0 < 0x100000000 && value0 > -(int64_t)0x80000000U) v |= 4;     // OPI_UINT32
+    if (code.value.u < 0x100) v |= 8;                                        // limit
+    if (code.value.u < 0x10000) v |= 0x10;
+    if (code.value.u < 0x100000000U) v |= 0x20;
+    for (int s = 0; s < 5; s++) {                // 8-bit memory offset scaled by operand size
+        if (!(code.offset_mem & ((1 << s) - 1)) && (code.offset_mem >> s) >= -0x80 && (code.offset_mem >> s) <= 0x7F) v |= 0x40 << s;
+    }
+    if (code.value.d > -129. && code.value.d < 128.) v |= 0x800;             // float converted to integer
+    if (code.value.d > -32769. && code.value.d < 32768.) v |= 0x1000;
+    if (code.value.d > -2147483649. && code.value.d < 2147483648.) v |= 0x2000;
+    if ((code.value.u >> 32) <= 0xFFFF) v |= 0x4000;                         // OPI_INT1632
+    if (code.value.w <= 0xFFFF && (code.value.u >> 32) <= 0xFFFF) v |= 0x8000; // OPI_2INT16
+    if (code.offset_jump == 0) v |= 0x10000;
+    for (uint32_t k = 0; k < nInstr; k++) {
+        SInstruction3 const & entry = instructionlistId[instrIndex + k];
+        if (entry.category == 1) {
+            v |= uint64_t(code.value.w & 0x3F) << 17;          // findFormat uses the low bits of the constant
+        }
+        if (entry.opimmediate == OPI_IMPLICIT && code.value.u == entry.implicit_imm) {
+            v |= uint64_t(1) << (32 + k);                    // explicit value equals implicit value
+        }
+    }
+    key.values = v;
+    if ((fitCacheNum + 1) * 2 > fitCache.numEntries()) {
+        // make table bigger. size is a power of 2, at least twice the number of entries
+        CDynamicArray<SFitCache> old;
+        old << fitCache;
+        fitCache.setNum(old.numEntries() ? old.numEntries() * 2 : 1024);
+        fitCache.zero();
+        for (uint32_t i = 0; i < old.numEntries(); i++) {
+            if (old[i].instr) fitCacheSlot(old[i]) = old[i];
+        }
+    }
+    return fitCacheSlot(key);
+}
+
+// Find entry in fitCache with the same key, or a vacant entry
+SFitCache & CAssembler::fitCacheSlot(SFitCache const & key) {
+    // hash of the 5 words of the key. The multiplication moves all bits up, so the high bits are used
+    uint64_t const * p = (uint64_t const *)&key;
+    uint64_t hash = 0;
+    for (int i = 0; i < 5; i++) hash = (hash ^ p[i]) * 0x9E3779B97F4A7C15;
+    uint32_t size = fitCache.numEntries();
+    uint32_t h = uint32_t(hash >> 32) & (size - 1);
+    while (fitCache[h].instr) {                            // linear probing
+        uint64_t const * q = (uint64_t const *)&fitCache[h];
+        if (q[0] == p[0] && q[1] == p[1] && q[2] == p[2] && q[3] == p[3] && q[4] == p[4]) break;  // found
+        h = (h + 1) & (size - 1);
+    }
+    return fitCache[h];
+}
+
 // check if instruction fits into specified format
 bool CAssembler::instructionFits(SCode const & code, SCode & codeTemp, uint32_t ii) {
     // code: structure defining all operands and options
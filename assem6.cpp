@@ -282,6 +282,11 @@ void CAssembler::pass5() {
     // make a databuffer for each section
     uint32_t nSections = sectionHeaders.numEntries();
     dataBuffers.setSize(nSections);
+    for (uint32_t i = 1; i < nSections; i++) {  // section sizes are known from pass 4
+        if (sectionHeaders[i].sh_type != SHT_NOBITS && sectionHeaders[i].sh_size < 0x80000000) {
+            dataBuffers[i].setSize((uint32_t)sectionHeaders[i].sh_size);
+        }
+    }
     section = 0;
 
     // make binary code from code records
@@ -324,6 +329,9 @@ void CAssembler::copySections() {
 
 // copy symbols to outFile
 void CAssembler::copySymbols() {
+    // the symbols are sorted by name only here, once, for the sake of a consistent output file
+    symbols.mergeSort();
+    symbolHashRebuild();
     for (uint32_t i = 0; i < symbols.numEntries(); i++) {
         // exclude section symbols and local constants
         if (symbols[i].st_type != STT_SECTION && symbols[i].st_type < STT_VARIABLE) {
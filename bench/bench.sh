@@ -0,0 +1,49 @@
+#!/bin/sh
+# Benchmark suite for the ForwardCom emulator
+# Date created:  2026-10-18
+# license: GPL
+# author: Agner Fog
+#
+# Assembles, links and emulates each benchmark kernel in this directory and
+# writes one line per kernel to a CSV file with the number of instructions,
+# host wall time, host CPU time, MIPS and execution time reported by -perf=json.
+#
+# usage: bench.sh [forw executable] [csv output file]
+# Run from the directory that contains instruction_list.csv, or use make -f forw.make bench
+
+forw=${1:-./forw}
+case $forw in /*) ;; *) forw=$(pwd)/$forw ;; esac
+csv=${2:-bench_results.csv}
+benchdir=$(dirname "$0")
+ilist=$(pwd)/instruction_list.csv
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+# extract a number from the JSON performance report
+field() {
+    sed -n "s/.*\"$1\": \([0-9.]*\).*/\1/p" "$2"
+}
+
+echo "name,instructions,wall_time,cpu_time,mips,execute_time" > "$csv"
+status=0
+for source in "$benchdir"/*.as; do
+    name=$(basename "$source" .as)
+    if ! "$forw" -ass "$source" "$tmp/$name.ob" -ilist="$ilist" -v0 \
+    || ! "$forw" -link "$tmp/$name.ex" "$tmp/$name.ob" -v0; then
+        echo "$name: build failed" >&2
+        status=1
+        continue
+    fi
+    # run in the temporary directory so that files written by the kernel are removed afterwards
+    (cd "$tmp" && "$forw" -emu "$name.ex" -ilist="$ilist" -perf=json) > "$tmp/$name.txt"
+    if ! grep -q '"instructions"' "$tmp/$name.txt"; then
+        echo "$name: emulation failed" >&2
+        status=1
+        continue
+    fi
+    line="$name,$(field instructions "$tmp/$name.txt"),$(field wall_time "$tmp/$name.txt"),$(field cpu_time "$tmp/$name.txt")"
+    line="$line,$(field mips "$tmp/$name.txt"),$(field execute "$tmp/$name.txt")"
+    echo "$line" >> "$csv"
+    echo "$line"
+done
+exit $status
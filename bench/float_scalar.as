@@ -0,0 +1,32 @@
+/**************************  float_scalar.as  ********************************
+* Emulator benchmark: scalar double precision floating point arithmetic
+******************************************************************************/
+
+const section read ip
+format: int8 "float_scalar result: %.6f\n", 0
+const end
+
+data section read write datap
+results: double 0
+data end
+
+code section execute ip
+__entry_point function public
+double v1 = 0
+double v2 = 1.0
+double v3 = 0.999999
+for (int64 r0 = 0; r0 < 1000000; r0++) {
+  double v2 = v2 * v3
+  double v4 = v2 + 0.5
+  double v5 = v4 / 1.5
+  double v1 = v1 + v5
+}
+int64 r0 = address([results])
+double [r0, scalar] = v1
+int64 r1 = r0
+int64 r0 = address([format])
+sys_call(r31, r31, 0x1, 0x103)     // printf
+int r0 = 0
+sys_call(0x1, 0x10)                // exit
+__entry_point end
+code end
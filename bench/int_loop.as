@@ -0,0 +1,31 @@
+/**************************  int_loop.as  ************************************
+* Emulator benchmark: integer arithmetic in a simple counting loop
+******************************************************************************/
+
+const section read ip
+format: int8 "int_loop checksum: %X\n", 0
+const end
+
+data section read write datap
+results: int64 0
+data end
+
+code section execute ip
+__entry_point function public
+int64 r1 = 0
+int64 r2 = 1
+for (int64 r0 = 0; r0 < 1000000; r0++) {
+  int64 r1 += r0
+  int64 r2 = r2 * 3
+  int64 r3 = r2 >> 7
+  int64 r1 ^= r3
+}
+int64 r0 = address([results])
+int64 [r0] = r1
+int64 r1 = r0
+int64 r0 = address([format])
+sys_call(r31, r31, 0x1, 0x103)     // printf
+int r0 = 0
+sys_call(0x1, 0x10)                // exit
+__entry_point end
+code end
@@ -0,0 +1,50 @@
+/**************************  jump_table.as  **********************************
+* Emulator benchmark: multiway branch through a table of relative addresses
+******************************************************************************/
+
+const section read ip
+jumptable: int32 (CASE0-JREF)/4, (CASE1-JREF)/4, (CASE2-JREF)/4, (CASE3-JREF)/4
+int32 (CASE4-JREF)/4, (CASE5-JREF)/4, (CASE6-JREF)/4, (CASE7-JREF)/4
+format: int8 "jump_table checksum: %lli\n", 0
+const end
+
+data section read write datap
+results: int64 0
+data end
+
+code section execute ip
+__entry_point function public
+int64 r3 = 0
+int64 r4 = address([jumptable])
+int64 r5 = address([JREF])
+for (int64 r2 = 0; r2 < 500000; r2++) {
+  int64 r1 = r2 * 5
+  int64 r1 &= 7
+  int32 jump_relative(r5, [r4+r1*4])
+  JREF:
+  CASE0: int64 r3 += 1
+  jump NEXT
+  CASE1: int64 r3 += 2
+  jump NEXT
+  CASE2: int64 r3 ^= 3
+  jump NEXT
+  CASE3: int64 r3 -= 1
+  jump NEXT
+  CASE4: int64 r3 += r2
+  jump NEXT
+  CASE5: int64 r3 <<= 1
+  jump NEXT
+  CASE6: int64 r3 >>= 1
+  jump NEXT
+  CASE7: int64 r3 |= 16
+  NEXT: nop
+}
+int64 r0 = address([results])
+int64 [r0] = r3
+int64 r1 = r0
+int64 r0 = address([format])
+sys_call(r31, r31, 0x1, 0x103)     // printf
+int r0 = 0
+sys_call(0x1, 0x10)                // exit
+__entry_point end
+code end
@@ -0,0 +1,48 @@
+/**************************  long_vector.as  *********************************
+* Emulator benchmark: vector loops with maximum vector length
+******************************************************************************/
+
+const section read ip
+format: int8 "long_vector result: %.6f\n", 0
+const end
+
+data section read write datap
+results: double 0
+data end
+
+bss section datap uninitialized
+double array[16384]
+bss end
+
+code section execute ip
+__entry_point function public
+// add 1.0 to all elements of the zero-initialized array
+int64 r1 = address([array+16384*8])          // end of array
+int64 r2 = 16384*8                           // size in bytes
+for (double v1 in [r1-r2]) {
+  double v1 = [r1-r2, length=r2]
+  double v1 = v1 + 1.0
+  double [r1-r2, length=r2] = v1
+}
+// multiply and add many times
+for (int64 r3 = 0; r3 < 200; r3++) {
+  int64 r2 = 16384*8
+  for (double v1 in [r1-r2]) {
+    double v1 = [r1-r2, length=r2]
+    double v2 = v1 * 1.0001
+    double v2 = v2 + 0.25
+    double [r1-r2, length=r2] = v2
+  }
+}
+// sum of first element
+int64 r0 = address([array])
+double v1 = [r0, scalar]
+int64 r0 = address([results])
+double [r0, scalar] = v1
+int64 r1 = r0
+int64 r0 = address([format])
+sys_call(r31, r31, 0x1, 0x103)     // printf
+int r0 = 0
+sys_call(0x1, 0x10)                // exit
+__entry_point end
+code end
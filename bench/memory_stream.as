@@ -0,0 +1,43 @@
+/**************************  memory_stream.as  *******************************
+* Emulator benchmark: scalar loads and stores streaming through large arrays
+******************************************************************************/
+
+const section read ip
+format: int8 "memory_stream checksum: %lli\n", 0
+const end
+
+data section read write datap
+results: int64 0
+data end
+
+bss section datap uninitialized
+int64 source[131072]
+int64 destination[131072]
+bss end
+
+code section execute ip
+__entry_point function public
+int64 r1 = address([source])
+int64 r2 = address([destination])
+// fill source array
+for (int64 r0 = 0; r0 < 131072; r0++) {
+  int64 [r1+r0*8] = r0
+}
+// copy and accumulate several times
+int64 r4 = 0
+for (int64 r3 = 0; r3 < 8; r3++) {
+  for (int64 r0 = 0; r0 < 131072; r0++) {
+    int64 r5 = [r1+r0*8]
+    int64 r4 += r5
+    int64 [r2+r0*8] = r5
+  }
+}
+int64 r0 = address([results])
+int64 [r0] = r4
+int64 r1 = r0
+int64 r0 = address([format])
+sys_call(r31, r31, 0x1, 0x103)     // printf
+int r0 = 0
+sys_call(0x1, 0x10)                // exit
+__entry_point end
+code end
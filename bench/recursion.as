@@ -0,0 +1,45 @@
+/**************************  recursion.as  ***********************************
+* Emulator benchmark: function calls and returns in a recursive Fibonacci function
+******************************************************************************/
+
+const section read ip
+format: int8 "recursion fib(25) = %i\n", 0
+const end
+
+data section read write datap
+results: int64 0
+data end
+
+code section execute ip
+
+// int64 fib(int64 n). parameter and result in r0. uses r1
+_fib function
+if (int64 r0 < 2) {
+  return
+}
+int64 r31 -= 16                    // save r0 and r1 on the data stack
+int64 [r31] = r1
+int64 [r31+8] = r0
+int64 r0 -= 1
+call _fib                          // fib(n-1)
+int64 r1 = r0
+int64 r0 = [r31+8]
+int64 r0 -= 2
+call _fib                          // fib(n-2)
+int64 r0 += r1
+int64 r1 = [r31]
+int64 r31 += 16
+return
+_fib end
+
+__entry_point function public
+int64 r0 = 25
+call _fib
+int64 r1 = address([results])
+int64 [r1] = r0
+int64 r0 = address([format])
+sys_call(r31, r31, 0x1, 0x103)     // printf
+int r0 = 0
+sys_call(0x1, 0x10)                // exit
+__entry_point end
+code end
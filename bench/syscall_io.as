@@ -0,0 +1,52 @@
+/**************************  syscall_io.as  **********************************
+* Emulator benchmark: formatted output and file writes through system functions
+******************************************************************************/
+
+const section read ip
+filename: int8 "syscall_io.tmp", 0
+filemode: int8 "wb", 0
+lineformat: int8 "line %i: %.3f\n", 0
+format: int8 "syscall_io lines written: %i\n", 0
+const end
+
+data section read write datap
+arguments: int64 0, 0
+int8 buffer[64]
+data end
+
+code section execute ip
+__entry_point function public
+int64 r0 = address([filename])
+int64 r1 = address([filemode])
+sys_call(r31, r31, 0x1, 0x110)     // fopen
+int64 r6 = r0                      // file handle
+int64 r7 = address([arguments])
+int64 r8 = address([buffer])
+for (int64 r5 = 0; r5 < 20000; r5++) {
+  int64 [r7] = r5
+  int64 v1 = gp2vec(r5)
+  double v0 = int2float(v1, 0)
+  double [r7+8, scalar] = v0
+  int64 r0 = r8                    // snprintf(buffer, 64, lineformat, arguments)
+  int64 r1 = 64
+  int64 r2 = address([lineformat])
+  int64 r3 = r7
+  sys_call(r8, r1, 0x1, 0x105)
+  int64 r2 = r0                    // fwrite(buffer, 1, length, file)
+  int64 r0 = r8
+  int64 r1 = 1
+  int64 r3 = r6
+  sys_call(r8, r2, 0x1, 0x113)
+}
+int64 r0 = r6
+sys_call(r31, r31, 0x1, 0x111)     // fclose
+int64 r0 = address([filename])
+sys_call(r31, r31, 0x1, 0x140)     // remove
+int64 [r7] = r5
+int64 r0 = address([format])
+int64 r1 = r7
+sys_call(r31, r31, 0x1, 0x103)     // printf
+int r0 = 0
+sys_call(0x1, 0x10)                // exit
+__entry_point end
+code end
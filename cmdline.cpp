@@ -63,6 +63,20 @@ void CCommandLineInterpreter::readCommandLine(int argc, char * argv[]) {
         // Output type not defined yet
         outputType = FILETYPE_FWC;
     }
+    if (fileList.numEntries()) {
+        // assembling multiple files. make output file name for each input file
+        if (outputListFile) {
+            err.submit(ERR_OUTFILE_IGNORED);     // one list file cannot be used for multiple files
+            outputListFile = 0;
+        }
+        for (uint32_t i = 0; i < fileList.numEntries(); i++) {
+            inputFile = fileList[i].filename;
+            outputFile = 0;
+            checkOutputFileName();
+            fileList[i].value = outputFile;
+        }
+        return;
+    }
     // check if output file name is valid
     checkOutputFileName();
 }
@@ -85,7 +99,10 @@ void CCommandLineInterpreter::readCommandItem(char * string) {
 
     if (*string == optionPrefix1 || *string == optionPrefix2) {
         // Option prefix found. This is a command line option
-        if (libmode) interpretLibraryOption(string+1);
+        if (strncasecmp_(string+1, "timings", 7) == 0 && (string[8] == 0 || string[8] == '=')) {
+            interpretTimingsOption(string+8);    // timings option is allowed with any command
+        }
+        else if (libmode) interpretLibraryOption(string+1);
         else if (linkmode) interpretLinkOption(string+1);
         else if (emumode) interpretEmulateOption(string+1);
         else if (job == CMDL_JOB_DUMP) interpretDumpOption(string+1);
@@ -237,6 +254,17 @@ void CCommandLineInterpreter::interpretFileName(char * string) {
         // Output file not specified yet
         outputFile = fileNameBuffer.pushString(string);
     }
+    else if (job == CMDL_JOB_ASS) {
+        // More than two file names. Assemble each file to an output file with default name
+        SLCommand file;
+        zeroAllMembers(file);
+        if (fileList.numEntries() == 0) {
+            file.filename = inputFile;   fileList.push(file);
+            file.filename = outputFile;  fileList.push(file);
+        }
+        file.filename = fileNameBuffer.pushString(string);
+        fileList.push(file);
+    }
     else {
         // Both input and output files already specified
         err.submit(ERR_MULTIPLE_IO_FILES);
@@ -310,11 +338,25 @@ void CCommandLineInterpreter::interpretCommandOption(char * string) {
         if (strncasecmp_(string, "ilist=", 6) == 0) {
         interpretIlistOption(string+6);
         }
+        else if (strncasecmp_(string, "ilisttable", 10) == 0 && string[10] == 0) {
+            if (job) err.submit(ERR_MULTIPLE_COMMANDS, string);     // More than one job specified
+            job = CMDL_JOB_TABLE;
+        }
+        else if (strncasecmp_(string, "incremental", 11) == 0 && string[11] == 0) {
+            assembleOptions |= CMDL_ASM_INCREMENTAL;
+        }
         else {        
             err.submit(ERR_UNKNOWN_OPTION, string);     // Unknown option
         }
         break;
 
+    case 'j':   // Jobs option
+        if (strncasecmp_(string, "jobs=", 5) == 0) {
+            interpretJobsOption(string+5);  break;
+        }
+        err.submit(ERR_UNKNOWN_OPTION, string);     // Unknown option
+        break;
+
     case 'l':   // Link, Library, and list file options
         if (strncasecmp_(string, "lib", 3) == 0) {
             if (job) err.submit(ERR_MULTIPLE_COMMANDS, string);     // More than one job specified
@@ -413,10 +455,46 @@ void CCommandLineInterpreter::interpretEmulateOption(char * string) {
     }
     // Detect option type
     switch(string[0] | 0x20) {
+    case 'b':   // breakpoints
+        if (strncasecmp_(string, "break=", 6) == 0 && string[6] > ' ') {
+            breakList = fileNameBuffer.pushString(string+6);  break;
+        }
+        err.submit(ERR_UNKNOWN_OPTION, string);     // Unknown option
+        break;
+    case 'g':   // GDB remote debugging
+        if (strncasecmp_(string, "gdb", 3) == 0 && string[3] == 0) {
+            gdbPort = 1234;  break;              // default port
+        }
+        if (strncasecmp_(string, "gdb=", 4) == 0) {
+            uint32_t error = 0;
+            gdbPort = (uint32_t)interpretNumber(string+4, 99, &error);
+            if (error || gdbPort == 0 || gdbPort > 0xFFFF) err.submit(ERR_UNKNOWN_OPTION, string);
+            break;
+        }
+        err.submit(ERR_UNKNOWN_OPTION, string);     // Unknown option
+        break;
+    case 'h':   // native library functions or heap
+        if (strncasecmp_(string, "hle", 3) == 0) {
+            interpretHleOption(string+3);  break;
+        }
+        if (strncasecmp_(string, "heapstat", 8) == 0 && string[8] == 0) {
+            emulateOptions |= CMDL_EMU_HEAPSTAT;  break;
+        }
+        if (strncasecmp_(string, "heap=", 5) == 0) {
+            interpretEmuHeapOption(string+5);  break;
+        }
+        err.submit(ERR_UNKNOWN_OPTION, string);     // Unknown option
+        break;
     case 'l':   // list option
         if (strncasecmp_(string, "list=", 5) == 0) {
             interpretListOption(string+5);  break;
         }
+        if (strncasecmp_(string, "listat=", 7) == 0 && string[7] > ' ') {
+            listAt = fileNameBuffer.pushString(string+7);  break;
+        }
+        if (strncasecmp_(string, "liststart=", 10) == 0 || strncasecmp_(string, "listlast=", 9) == 0) {
+            interpretListWindowOption(string);  break;
+        }
         err.submit(ERR_UNKNOWN_OPTION, string-1);  // Unknown option
         break;
     case 'm':
@@ -428,6 +506,30 @@ void CCommandLineInterpreter::interpretEmulateOption(char * string) {
         }        
         err.submit(ERR_UNKNOWN_OPTION, string);     // Unknown option
         break;
+    case 'p':   // performance report
+        if (strncasecmp_(string, "perf", 4) == 0 && string[4] == 0) {
+            emulateOptions |= CMDL_EMU_PERF;  break;
+        }
+        if (strncasecmp_(string, "perf=json", 9) == 0 && string[9] == 0) {
+            emulateOptions |= CMDL_EMU_PERF | CMDL_EMU_PERF_JSON;  break;
+        }
+        err.submit(ERR_UNKNOWN_OPTION, string);     // Unknown option
+        break;
+    case 'r':   // record or replay
+        if (strncasecmp_(string, "record=", 7) == 0 && string[7] > ' ' && !replayFile) {
+            recordFile = fileNameBuffer.pushString(string+7);  break;
+        }
+        if (strncasecmp_(string, "replay=", 7) == 0 && string[7] > ' ' && !recordFile) {
+            replayFile = fileNameBuffer.pushString(string+7);  break;
+        }
+        err.submit(ERR_UNKNOWN_OPTION, string);     // Unknown option
+        break;
+    case 'w':   // watchpoints or warning option
+        if (strncasecmp_(string, "watch=", 6) == 0 && string[6] > ' ') {
+            watchList = fileNameBuffer.pushString(string+6);  break;
+        }
+        interpretErrorOption(string);
+        break;
     }
 
 }
@@ -724,6 +826,20 @@ void CCommandLineInterpreter::interpretMaxErrorsOption(char * string) {
     if (error) err.submit(ERR_UNKNOWN_OPTION, string);
 }
 
+void CCommandLineInterpreter::interpretJobsOption(char * string) {
+    // Interpret jobs option from command line
+    uint32_t error = 0;
+    numJobs = (uint32_t)interpretNumber(string, 99, &error);
+    if (error || numJobs == 0) err.submit(ERR_UNKNOWN_OPTION, string);
+}
+
+void CCommandLineInterpreter::interpretTimingsOption(char * string) {
+    // Interpret timings option from command line
+    if (string[0] == 0) timings = CMDL_TIMINGS;
+    else if (strncasecmp_(string, "=json", 5) == 0 && string[5] == 0) timings = CMDL_TIMINGS | CMDL_TIMINGS_JSON;
+    else err.submit(ERR_UNKNOWN_OPTION, string - 7);  // string - 7 points to "timings"
+}
+
 void CCommandLineInterpreter::interpretCodeSizeOption(char * string) {
     // Interpret codesize option from command line
     uint32_t error = 0;
@@ -801,6 +917,40 @@ void CCommandLineInterpreter::interpretMaxLinesOption(char * string) {
 }
 
 
+void CCommandLineInterpreter::interpretListWindowOption(char * string) {
+    // Interpret liststart and listlast options for emulator output list
+    uint32_t error = 0;
+    if ((string[4] | 0x20) == 's') {             // liststart=N: start listing after N instructions
+        listStartCount = interpretNumber(string+10, 99, &error);
+    }
+    else {                                       // listlast=N: list last N instructions before an interrupt
+        listLast = (uint32_t)interpretNumber(string+9, 99, &error);
+        if (listLast > 0x100000) error = 1;
+    }
+    if (error) err.submit(ERR_UNKNOWN_OPTION, string);
+}
+
+void CCommandLineInterpreter::interpretHleOption(char * string) {
+    // Interpret option for native high-level emulation of library functions
+    // -hle: all supported functions. -hle=name1,name2: only the listed functions
+    if (string[0] == 0) {
+        hleList = fileNameBuffer.pushString("all");
+    }
+    else if (string[0] == '=' && string[1] != 0) {
+        hleList = fileNameBuffer.pushString(string+1);
+    }
+    else err.submit(ERR_UNKNOWN_OPTION, string);
+}
+
+void CCommandLineInterpreter::interpretEmuHeapOption(char * string) {
+    // Interpret heap size option for emulator
+    uint32_t error = 0;
+    heapSizeOption = interpretNumber(string, 99, &error);
+    // the heap size is rounded down to whole heap pages. a smaller value would give no heap
+    if (error || heapSizeOption < heap_page_size) err.submit(ERR_UNKNOWN_OPTION, string);
+}
+
+
 void CCommandLineInterpreter::reportStatistics() {
     // Report statistics about name changes etc.
 }
@@ -877,6 +1027,7 @@ void CCommandLineInterpreter::help() {
     printf("\nBinary tools version %i.%02i for ForwardCom instruction set.", FORWARDCOM_VERSION, FORWARDCOM_SUBVERSION);
     printf("\nCopyright (c) 2025 by Agner Fog. Gnu General Public License.");
     printf("\n\nUsage: forw command [options] inputfile [outputfile] [options]");
+    printf("\n       forw -ass [options] inputfile1 inputfile2 inputfile3 ... [options]");
     printf("\n\nCommand:");
     printf("\n-ass       Assemble\n");
     printf("\n-dis       Disassemble object or executable file\n");
@@ -884,6 +1035,7 @@ void CCommandLineInterpreter::help() {
     printf("\n-relink    Relink and modify executable file\n");
     printf("\n-lib       Build or manage library file\n");
     printf("\n-emu       Emulate and debug executable file\n");
+    printf("\n-ilisttable Make C++ header file from instruction list file, for building forw_embedded\n");
     printf("\n-dump-XXX  Dump file contents to console.");
     printf("\n           Values of XXX (can be combined):");
     printf("\n           f: File header, h: section Headers, s: Symbol table,");
@@ -893,13 +1045,39 @@ void CCommandLineInterpreter::help() {
     printf("\n\nAssemble options:");
     printf("\n-list=filename Specify file for output listing.");
     printf("\n-ON        Optimization level. N = 0-2.");
+    printf("\n-incremental Reuse the interpreted code of functions that are unchanged since the last");
+    printf("\n           assembly of the same file. The code is saved in the object file name + .cache");
+    printf("\n-jobs=N    Number of files assembled simultaneously when more than two input files");
+    printf("\n           are specified. Default = number of processors.");
+
+    printf("\n\nEmulate options:");
+    printf("\n-list=filename Specify file for debug output listing.");
+    printf("\n-maxlines=N Maximum number of lines in debug output listing.");
+    printf("\n-liststart=N Start debug output listing after N instructions.");
+    printf("\n-listat=location Start debug output listing at code symbol or address.");
+    printf("\n-listlast=N Write last N instructions to debug output listing when an interrupt occurs.");
+    printf("\n-hle[=f1,f2] Replace library functions by native versions (memcpy, strlen, etc.)");
+    printf("\n-heap=N    Size of heap for malloc system function. Default = 1 MB.");
+    printf("\n-heapstat  Report heap usage statistics.");
+    printf("\n-perf      Report number of instructions, MIPS, and time used in each phase. -perf=json: same in JSON format.");
+    printf("\n-record=filename Record results of system functions that depend on the environment.");
+    printf("\n-replay=filename Replay recorded system function results instead of accessing files, etc.");
+    printf("\n-break=b1,b2 Breakpoints. Each is a code symbol or address, optionally followed by");
+    printf("\n           a condition :rN=value or :rN!=value. Registers are dumped when a breakpoint is hit.");
+    printf("\n-watch=w1,w2 Watchpoints. Each is a data symbol or address, optionally followed by");
+    printf("\n           :size, :r, :w, :rw, and a condition. Default is 8 bytes, write.");
+    printf("\n           With -list, the listing starts at the first breakpoint or watchpoint hit.");
+    printf("\n-gdb[=port] Wait for connection from GDB remote debugger on localhost. Default port 1234.");
 
     printf("\n\nGeneral options:");
     printf("\n-ilist=filename Specify instruction list file.");
+    printf("\n           A parsed copy is saved in filename.cache for faster loading.");
     printf("\n-wdNNN     Disable Warning NNN.");
     printf("\n-weNNN     treat Warning NNN as Error. -wex: treat all warnings as errors.");
     printf("\n-edNNN     Disable Error number NNN.");
     printf("\n-ewNNN     treat Error number NNN as Warning.");
+    printf("\n-timings   Report wall time, CPU time, and peak buffer memory in each stage of the job.");
+    printf("\n           -timings=json: same in JSON format.");
     printf("\n@RFILE     Read additional options from response file RFILE.");
     printf("\n\nExample:");
     printf("\nforw -ass test.as test.ob");
@@ -29,6 +29,7 @@ const int CMDL_JOB_LINK =               4;       // Link
 const int CMDL_JOB_RELINK =             5;       // Relink
 const int CMDL_JOB_LIB =                6;       // Library
 const int CMDL_JOB_EMU =                8;       // Emulate/Debug
+const int CMDL_JOB_TABLE =              9;       // Make C++ header with instruction list
 const int CMDL_JOB_HELP =          0x1000;       // Show help
 
 // Constants for verbose or silent console output
@@ -80,8 +81,21 @@ const int CMDL_LINK_DYNLINKSIZE =    0x800;    // extra size for dynamic linking
 const int CMDL_LINK_RELINKABLE =   0x10000;    // add as relinkable the following object files and library files
 const int CMD_NAME_FOUND =       0x1000000;    // mark name found in rnames record
 
+// Emulator options
+const int CMDL_EMU_HEAPSTAT =            1;    // report heap usage statistics
+const int CMDL_EMU_PERF =                2;    // report emulator speed and time used in each phase
+const int CMDL_EMU_PERF_JSON =           4;    // report emulator speed in JSON format
 
-// Structure for storing library or linker commands from command line
+// Assembler options
+const int CMDL_ASM_INCREMENTAL =         1;    // reuse interpreted code of unchanged functions from the previous run
+
+// Timing report options
+const int CMDL_TIMINGS =                 1;    // report time and memory used in each stage of any job
+const int CMDL_TIMINGS_JSON =            2;    // report timings in JSON format
+
+
+// Structure for storing library or linker commands from command line,
+// or input and output files when assembling multiple files
 struct SLCommand {
     uint32_t filename;                           // full file name, as index into cmd.fileNameBuffer
     uint32_t command;                            // library commands or linker commands
@@ -99,6 +113,16 @@ public:
     uint32_t outputFile;                      // Output file name. index into fileNameBuffer
     uint32_t instructionListFile;             // File name of instruction list. index into fileNameBuffer
     uint32_t outputListFile;                  // File name of assembler or emulator or linker output list file. index into fileNameBuffer
+    uint32_t hleList;                         // Library functions to replace by native versions in emulator. index into fileNameBuffer
+    uint32_t recordFile;                      // File for recording system function results in emulator. index into fileNameBuffer
+    uint32_t replayFile;                      // File for replaying recorded system function results in emulator. index into fileNameBuffer
+    uint32_t breakList;                       // Breakpoints in emulator. index into fileNameBuffer
+    uint32_t watchList;                       // Watchpoints in emulator. index into fileNameBuffer
+    uint32_t gdbPort;                         // Port for GDB remote debugging of emulator
+    uint32_t listAt;                          // Start emulator output list at this code location. index into fileNameBuffer
+    uint32_t listLast;                        // Number of instructions before interrupt to write to emulator output list
+    uint32_t numJobs;                         // Number of files to assemble simultaneously. 0 = number of processors
+    uint64_t listStartCount;                  // Start emulator output list after this number of instructions
     int  job;                                 // Job to do: ass, dis, dump, link, lib, emu
     int  inputType;                           // Input file type (detected from file)
     int  outputType;                          // Output type (file type or dump)
@@ -111,8 +135,12 @@ public:
     uint32_t libraryOptions;                  // Options for library operations
     uint32_t linkOptions;                     // Options for linking
     uint32_t debugOptions;                    // Options for debug info in assembly. not fully supported yet
+    uint32_t emulateOptions;                  // Options for emulator
+    uint32_t assembleOptions;                 // Options for assembler
+    uint32_t timings;                         // Options for timing report
     uint64_t codeSizeOption;                  // Option specifying max code size
     uint64_t dataSizeOption;                  // Option specifying max data size
+    uint64_t heapSizeOption;                  // Option specifying heap size in emulator
     const char * programName;                 // Path and name of this program
     void checkExtractSuccess();               // Check if library members to extract were found
     const char * getFilename(uint32_t n);     // Get file name from index
@@ -148,12 +176,18 @@ protected:
     void interpretDumpOption(char *);         // Interpret dump option from command line
     void interpretErrorOption(char *);        // Interpret error option from command line
     void interpretMaxLinesOption(char * string);// Interpret maxlines option from command line
+    void interpretHleOption(char * string);   // Interpret native library function option for emulator
+    void interpretListWindowOption(char * string); // Interpret liststart and listlast options for emulator
+    void interpretEmuHeapOption(char * string);// Interpret heap size option for emulator
+    void interpretJobsOption(char * string);  // Interpret jobs option for assembler
+    void interpretTimingsOption(char * string); // Interpret timings option for any job
     void checkOutputFileName();               // Make output file name or check that requested name is valid
     uint32_t setFileNameExtension(uint32_t fn, int filetype);   // Set file name extension according to FileType
     void help();                              // Print help message
 public:
     CMemoryBuffer fileNameBuffer;             // Buffer containing names of files from command line
     CDynamicArray<SLCommand> lcommands;       // List of linker or library commands from command line
+    CDynamicArray<SLCommand> fileList;        // Input files (filename) and output files (value) when assembling more than one file
 };
 
 int strncasecmp_(const char *s1, const char *s2, uint32_t n); // compare strings, ignore case for a-z
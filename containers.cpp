@@ -13,6 +13,12 @@
 *****************************************************************************/
 
 #include "stdafx.h"
+#if defined (_WIN32) || defined (__WINDOWS__)
+#include <process.h>                             // _getpid
+#define getpid _getpid
+#else
+#include <unistd.h>                              // getpid
+#endif
 
 // Names of file formats
 SIntTxt FileFormatNames[] = {
@@ -27,6 +33,9 @@ SIntTxt FileFormatNames[] = {
 
 // Members of class CMemoryBuffer
 
+uint64_t CMemoryBuffer::totalSize = 0;
+uint64_t CMemoryBuffer::peakSize = 0;
+
 // Constructor
 CMemoryBuffer::CMemoryBuffer() {  
     buffer = 0;
@@ -40,7 +49,10 @@ CMemoryBuffer::~CMemoryBuffer() {
 
 // De-allocate buffer
 void CMemoryBuffer::clear() {
-    if (buffer) delete[] buffer;
+    if (buffer) {
+        delete[] buffer;
+        countSize(-(int64_t)buffer_size);
+    }
     buffer = 0;
     num_entries = data_size = buffer_size = 0;
 }
@@ -69,12 +81,13 @@ void CMemoryBuffer::setSize(uint32_t size) {
     int8_t * buffer2 = 0;                        // New buffer
     buffer2 = new int8_t[size];                  // Allocate new buffer
     if (buffer2 == 0) {err.submit(ERR_MEMORY_ALLOCATION); return;} // Error can't allocate
-    memset (buffer2, 0, size);                   // Initialize to all zeroes
     if (buffer) {
         // A smaller buffer is previously allocated
         memcpy (buffer2, buffer, buffer_size);   // Copy contents of old buffer into new
         delete[] buffer;                         // De-allocate old buffer
     }
+    memset (buffer2 + buffer_size, 0, size - buffer_size); // Initialize the rest to zeroes
+    countSize(size - buffer_size);
     buffer = buffer2;                            // Save pointer to buffer
     buffer_size = size;                          // Save size
 }
@@ -119,13 +132,14 @@ uint32_t CMemoryBuffer::push(void const * obj, uint32_t size) {
             // Error can't allocate
             err.submit(ERR_MEMORY_ALLOCATION);  return 0;
         }
-        // Initialize to all zeroes
-        memset (buffer2, 0, NewSize);
         if (buffer) {
             // A smaller buffer is previously allocated
             // Copy contents of old buffer into new
             memcpy (buffer2, buffer, buffer_size);
         }
+        // Initialize the rest to zeroes
+        memset (buffer2 + buffer_size, 0, NewSize - buffer_size);
+        countSize(NewSize - buffer_size);
         buffer_size = NewSize;                   // Save size
         if (obj && size) {                         
             // Copy object to new buffer
@@ -322,6 +336,28 @@ void CFileBuffer::write(const char * filename) {
 #endif
 }
 
+// Write buffer to a temporary file with a unique name and rename it to filename, so that
+// concurrent writers cannot mix their output. A reader will see either the old or the new file.
+// Errors are not reported. Returns false if the file could not be written
+bool CFileBuffer::writeReplace(const char * filename) {
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%u.tmp", (unsigned int)getpid());
+    CMemoryBuffer tempName;
+    tempName.push(filename, (uint32_t)strlen(filename));
+    tempName.pushString(suffix);
+    const char * temp = tempName.getString(0);
+    FILE * f = fopen(temp, "wb");
+    if (f == 0) return false;                    // directory may be write protected
+    bool ok = fwrite(buf(), 1, data_size, f) == data_size;
+    if (fclose(f) != 0) ok = false;
+    if (ok && rename(temp, filename) != 0) {
+        remove(filename);                        // rename does not replace an existing file on Windows
+        ok = rename(temp, filename) == 0;
+    }
+    if (!ok) remove(temp);
+    return ok;
+}
+
 int CFileBuffer::getFileType() {
     // Detect file type
     //if (fileType) return fileType;             // Must re-evaluate fileType in case buffer is reused
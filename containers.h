@@ -109,6 +109,11 @@ public:
        return (char *)(buffer + offset);
    }
    void copy(CMemoryBuffer const & b);           // Make a copy of whole buffer
+   static uint64_t totalSize;                    // Size of all allocated buffers. Used for timing report
+   static uint64_t peakSize;                     // Maximum of totalSize since last reset
+   static void countSize(int64_t change) {       // Add to totalSize and update peakSize
+      totalSize += change;
+      if (totalSize > peakSize) peakSize = totalSize;}
 private:
    CMemoryBuffer(CMemoryBuffer&);                // Make private copy constructor to prevent simple copying
    CMemoryBuffer & operator = (CMemoryBuffer const&);// Make assignment operator to prevent simple copying
@@ -131,6 +136,7 @@ public:
    //CFileBuffer(uint32_t filename);               // Constructor
    void read(const char * filename, int ignoreError = 0);               // Read file into buffer
    void write(const char * filename);                                 // Write buffer to file
+   bool writeReplace(const char * filename);                          // Write buffer to temporary file and rename it
    int  getFileType();                           // Get file format type
    void setFileType(int type);                   // Set file format type
    void reset();                                 // Set all members to zero
@@ -232,6 +238,28 @@ public:
         } while (swapped);                                 // Early out if already mostly sorted
     }
 
+    // Sort list in ascending order with a merge sort. The result is the same as with sort(),
+    // but the time is proportional to n*log(n) rather than n^2. Use this for big lists
+    void mergeSort() {
+        uint32_t n = num_entries;
+        if (n < 2) return;
+        CMemoryBuffer temp;                                // temporary buffer of same size
+        temp.setSize(n * (uint32_t)sizeof(TX));
+        TX * a = (TX*)buf(), * b = (TX*)temp.buf(), * t;
+        for (uint32_t width = 1; width < n; width *= 2) {  // merge runs of size width from a into b
+            for (uint32_t lo = 0; lo < n; lo += 2 * width) {
+                uint32_t mid = lo + width < n ? lo + width : n;
+                uint32_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+                uint32_t i = lo, j = mid, k = lo;
+                while (i < mid && j < hi) b[k++] = (a[j] < a[i]) ? a[j++] : a[i++];  // equal records keep their order
+                while (i < mid) b[k++] = a[i++];
+                while (j < hi) b[k++] = a[j++];
+            }
+            t = a;  a = b;  b = t;
+        }
+        if (a != (TX*)buf()) memcpy(buf(), a, n * sizeof(TX));
+    }
+
     int32_t findFirst(TX const & x) {            
         // Finds matching record and returns index to the first matching record
         // Important: The list must be sorted first
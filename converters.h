@@ -69,9 +69,11 @@ protected:
     void dumpELF();                     // Dump x86 ELF file
     void disassemble();                 // Disassemble ForwardCom ELF file
     void assemble();                    // Assemble ForwardCom assembly file
+    void assembleFiles();               // Assemble multiple ForwardCom assembly files
     void link();                        // Link object files into executable file
     void emulate();                     // emulate and run executable file
     void lib();                         // Build or modify function libraries
+    void instructionTable();            // Make C++ header file with instruction list
 };
 
 // Class for interpreting and dumping ELF files
@@ -11,6 +11,9 @@
 * Copyright 2007-2024 GNU General Public License http://www.gnu.org/licenses
 *****************************************************************************/
 #include "stdafx.h"
+#ifdef EMBEDDED_INSTRUCTION_LIST
+#include "instruction_table.h"                   // generated by forw -ilisttable
+#endif
 
 
 uint64_t interpretTemplateVariants(const char * s) {
@@ -304,12 +307,11 @@ CDisassembler::CDisassembler() {
 };
 
 void CDisassembler::initializeInstructionList() {
-    // Read and initialize instruction list and sort it by category, format, and op1
+    // Read and initialize instruction list sorted by category, format, and op1
+    if (instructionlist.numEntries()) return;    // already read
     CCSVFile instructionListFile;
-    instructionListFile.read(cmd.getFilename(cmd.instructionListFile), CMDL_FILE_SEARCH_PATH);  // Filename of list of instructions
-    instructionListFile.parse();                 // Read and interpret instruction list file
-    instructionlist << instructionListFile.instructionlist; // Transfer instruction list to my own container
-    instructionlist.sort();                      // Sort list, using sort order defined by SInstruction2
+    instructionListFile.load();                  // Read instruction list file or cache, and sort it
+    instructionlist << instructionListFile.instructionlist2; // Transfer sorted instruction list to my own container
 }
 
 // Read instruction list, split ELF file into components
@@ -368,6 +370,9 @@ void CDisassembler::go() {
         pass = 2;
         pass1();
     }
+    // timing stages are recorded only for the disassemble command. The listings made by the
+    // assembler and the emulator are part of their own stages
+    if (cmd.job == CMDL_JOB_DIS) timingStage("pass1");
 
     // Join the tables: symbols and newSymbols;
     joinSymbolTables();
@@ -384,9 +389,13 @@ void CDisassembler::go() {
 
     // Finish writing output file
     writeFileEnd();
+    if (cmd.job == CMDL_JOB_DIS) timingStage("pass2");
 
     // write output file
-    if (outputFile && !debugMode) outFile.write(cmd.getFilename(outputFile));
+    if (outputFile && !debugMode) {
+        outFile.write(cmd.getFilename(outputFile));
+        if (cmd.job == CMDL_JOB_DIS) timingStage("write");
+    }
 }
 
 // write feedback text on stdout
@@ -979,6 +988,241 @@ uint64_t CCSVFile::interpretNumber(const char * text) {
     return result;
 } 
 
+// Get lists sorted by name, id, and operation code. The lists are loaded only once
+// per process and copied for subsequent calls. Processes started by fork for
+// assembling multiple files share the lists loaded before the fork
+void CCSVFile::load() {
+    static CCSVFile loaded;                      // lists loaded by first call
+    if (loaded.instructionlist.numEntries() == 0) {
+        loaded.loadFile();
+        if (err.number()) return;
+    }
+    instructionlist.copy(loaded.instructionlist);
+    instructionlistNm.copy(loaded.instructionlistNm);
+    instructionlistId.copy(loaded.instructionlistId);
+    instructionlist2.copy(loaded.instructionlist2);
+    reservedNames.copy(loaded.reservedNames);
+    reservedHash.copy(loaded.reservedHash);
+    reservedSeeds.copy(loaded.reservedSeeds);
+}
+
+// Read instruction list file and make lists sorted by name, id, and operation code.
+// The parsed and sorted lists are saved in a binary cache file next to the
+// instruction list file. The cache is used instead of parsing and sorting as
+// long as the hash of the instruction list file is unchanged
+void CCSVFile::loadFile() {
+#ifdef EMBEDDED_INSTRUCTION_LIST
+    // use the embedded instruction list unless another instruction list file is specified,
+    // or instruction_list.csv exists and has been changed since the program was built
+    if (strcmp(cmd.getFilename(cmd.instructionListFile), "instruction_list.csv") == 0) {
+        CMemoryBuffer path;
+        listPath(path);
+        path.pushString("");
+        read(path.getString(0), CMDL_FILE_IN_IF_EXISTS);
+        if (dataSize() == 0 || hashBytes(buf(), dataSize()) == embeddedListHash) {
+            SInstruction nullInstruction;        // empty record
+            zeroAllMembers(nullInstruction);
+            instructionlist.pushBig(embeddedList, sizeof(embeddedList));
+            for (uint32_t i = 0; i < embeddedNumInstructions; i++) {
+                instructionlistNm.push(embeddedList[embeddedOrderNm[i]]);
+                instructionlist2.push(*(SInstruction2 const*)&embeddedList[embeddedOrder2[i]]);
+            }
+            for (uint32_t i = 0; i <= embeddedNumInstructions; i++) {
+                uint32_t j = embeddedOrderId[i];
+                instructionlistId.push(*(SInstruction3 const*)(j < embeddedNumInstructions ? &embeddedList[j] : &nullInstruction));
+            }
+            // hash table of register names, keywords, and instruction names for the assembler
+            reservedNames.pushBig(embeddedReservedNames, sizeof(embeddedReservedNames));
+            reservedHash.pushBig(embeddedReservedHash, sizeof(embeddedReservedHash));
+            reservedSeeds.pushBig(embeddedReservedSeeds, sizeof(embeddedReservedSeeds));
+            return;
+        }
+    }
+#endif
+    if (dataSize() == 0) read(cmd.getFilename(cmd.instructionListFile), CMDL_FILE_SEARCH_PATH);
+    if (err.number()) return;
+    uint64_t csvHash = hashBytes(buf(), dataSize());    // hash before parse() modifies the buffer
+    CMemoryBuffer name;
+    cacheName(name);
+    if (readCache((char*)name.buf(), csvHash)) return;
+    parse();
+    if (err.number()) return;
+    sortLists();
+    writeCache((char*)name.buf(), csvHash);
+}
+
+// make lists sorted by name, id, and operation code from instructionlist
+void CCSVFile::sortLists() {
+    instructionlistNm.copy(instructionlist);
+    instructionlistId.copy(instructionlist);
+    instructionlist2.copy(instructionlist);
+    SInstruction3 nullInstruction;               // empty record
+    zeroAllMembers(nullInstruction);
+    instructionlistId.push(nullInstruction);     // Empty record will go to position 0 to avoid an instruction with index 0
+    instructionlistNm.sort();                    // Sort by name
+    instructionlistId.sort();                    // Sort by id
+    instructionlist2.sort();                     // Sort by category, format, and op1
+}
+
+// make path of instruction list file without terminating zero.
+// The instruction list file may be in the directory of the executable file
+void CCSVFile::listPath(CMemoryBuffer & name) {
+    const char * filename = cmd.getFilename(cmd.instructionListFile);
+    FILE * f = fopen(filename, "rb");
+    if (f) fclose(f);
+    else {
+        // file was found in directory of executable file
+#if defined (_WIN32) || defined (__WINDOWS__)
+        const char * slash = strrchr(cmd.programName, '\\');
+#else
+        const char * slash = strrchr(cmd.programName, '/');
+#endif
+        if (slash) name.push(cmd.programName, uint32_t(slash + 1 - cmd.programName));
+    }
+    name.push(filename, (uint32_t)strlen(filename));
+}
+
+// make file name of binary cache: name of instruction list file + ".cache"
+void CCSVFile::cacheName(CMemoryBuffer & name) {
+    listPath(name);
+    name.pushString(".cache");
+}
+
+// read binary cache of instruction list. return false if missing or outdated
+bool CCSVFile::readCache(const char * name, uint64_t csvHash) {
+    CFileBuffer cache;
+    cache.read(name, CMDL_FILE_IN_IF_EXISTS);
+    if (cache.dataSize() < sizeof(SInstructionCacheHeader)) return false;
+    SInstructionCacheHeader & header = *(SInstructionCacheHeader*)cache.buf();
+    uint32_t n = header.numInstructions;
+    uint32_t listSize = n * (uint32_t)sizeof(SInstruction);
+    if (strcmp(header.signature, "FWCILST") != 0 || header.recordSize != sizeof(SInstruction)
+    || header.csvSize != dataSize() || header.csvHash != csvHash || n == 0 || n > 0x100000
+    || cache.dataSize() != sizeof(SInstructionCacheHeader) + listSize * 4 + sizeof(SInstruction)) return false;
+    const int8_t * p = cache.buf() + sizeof(SInstructionCacheHeader);
+    if (hashBytes(p, cache.dataSize() - sizeof(SInstructionCacheHeader)) != header.dataHash) return false;
+    // the lists are stored in this order: unsorted, by name, by id (with one extra record), by operation code
+    instructionlist.setNum(n);    memcpy(instructionlist.buf(), p, listSize);  p += listSize;
+    instructionlistNm.setNum(n);  memcpy(instructionlistNm.buf(), p, listSize);  p += listSize;
+    instructionlistId.setNum(n+1);  memcpy(instructionlistId.buf(), p, listSize + sizeof(SInstruction));  p += listSize + sizeof(SInstruction);
+    instructionlist2.setNum(n);   memcpy(instructionlist2.buf(), p, listSize);
+    return true;
+}
+
+// write binary cache of instruction list. failure is ignored
+void CCSVFile::writeCache(const char * name, uint64_t csvHash) {
+    SInstructionCacheHeader header;
+    zeroAllMembers(header);
+    strcpy(header.signature, "FWCILST");
+    header.recordSize = sizeof(SInstruction);
+    header.numInstructions = instructionlist.numEntries();
+    header.csvSize = dataSize();
+    header.csvHash = csvHash;
+    CFileBuffer cache;
+    cache.push(&header, sizeof(header));
+    cache.push(instructionlist.buf(), instructionlist.dataSize());
+    cache.push(instructionlistNm.buf(), instructionlistNm.dataSize());
+    cache.push(instructionlistId.buf(), instructionlistId.dataSize());
+    cache.push(instructionlist2.buf(), instructionlist2.dataSize());
+    ((SInstructionCacheHeader*)cache.buf())->dataHash = hashBytes(cache.buf() + sizeof(header), cache.dataSize() - sizeof(header));
+    cache.writeReplace(name);                    // a reader will see either the old or the new file
+}
+
+// find the index into the unsorted list of each record in a sorted list. 0xFFFF if not found
+static void findOrder(CDynamicArray<SInstruction> & list, void const * sorted, uint32_t num, CDynamicArray<uint16_t> & order) {
+    CDynamicArray<uint8_t> used;                 // record in unsorted list has been assigned
+    used.setNum(list.numEntries());
+    for (uint32_t i = 0; i < num; i++) {
+        SInstruction const * rec = (SInstruction const *)sorted + i;
+        uint16_t k = 0xFFFF;
+        for (uint32_t j = 0; j < list.numEntries(); j++) {
+            if (!used[j] && memcmp(&list[j], rec, sizeof(SInstruction)) == 0) {
+                used[j] = 1;  k = (uint16_t)j;  break;
+            }
+        }
+        order.push(k);
+    }
+}
+
+// write array of 16-bit numbers to header file
+static void putArray(CTextFileBuffer & out, const char * name, CDynamicArray<uint16_t> & a) {
+    out.put("constexpr uint16_t ");  out.put(name);  out.put("[");
+    out.putDecimal(a.numEntries());  out.put("] = {");
+    for (uint32_t i = 0; i < a.numEntries(); i++) {
+        if ((i & 15) == 0) {
+            out.newLine();  out.put("   ");
+        }
+        out.put(' ');  out.putDecimal(a[i]);  out.put(',');
+    }
+    out.newLine();  out.put("};");  out.newLine();  out.newLine();
+}
+
+// Write C++ header file with the instruction list for compiling disasm1.cpp with EMBEDDED_INSTRUCTION_LIST.
+// The lists sorted by name, id, and operation code are stored as indexes into the unsorted list.
+// The assembler's perfect hash table of reserved names is stored as well
+void CCSVFile::makeHeader() {
+    uint64_t csvHash = hashBytes(buf(), dataSize());
+    parse();
+    if (err.number()) return;
+    uint32_t n = instructionlist.numEntries();
+    if (n == 0 || n >= 0xFFFF) {
+        err.submit(ERR_INSTRUCTION_LIST_SYNTAX, cmd.getFilename(cmd.inputFile));  return;
+    }
+    sortLists();
+    CDynamicArray<uint16_t> orderNm, orderId, order2;
+    findOrder(instructionlist, instructionlistNm.buf(), n, orderNm);
+    findOrder(instructionlist, instructionlistId.buf(), n + 1, orderId);
+    findOrder(instructionlist, instructionlist2.buf(), n, order2);
+
+    // write header file
+    CTextFileBuffer out;
+    out.put("// instruction_table.h. Generated by forw -ilisttable from ");
+    out.put(cmd.getFilename(cmd.inputFile));  out.put(". Do not edit.");  out.newLine();
+    out.put("// Used when disasm1.cpp is compiled with EMBEDDED_INSTRUCTION_LIST defined");
+    out.newLine();  out.newLine();
+    out.put("const uint64_t embeddedListHash = ");  out.putHex(csvHash);
+    out.put(";        // hash of instruction list file");  out.newLine();
+    out.put("const uint32_t embeddedNumInstructions = ");  out.putDecimal(n);  out.put(";");  out.newLine();
+    out.newLine();
+    out.put("// format, variant, id, category, templt, sourceoperands, op1, op2, opimmediate, implicit_imm,");  out.newLine();
+    out.put("// optypesgp, optypesscalar, optypesvector, name");  out.newLine();
+    out.put("constexpr SInstruction embeddedList[");  out.putDecimal(n);  out.put("] = {");  out.newLine();
+    for (uint32_t i = 0; i < n; i++) {
+        SInstruction & r = instructionlist[i];
+        out.put("    {");
+        out.putHex(r.format);  out.put(", ");  out.putHex(r.variant);  out.put(", ");
+        out.putHex(r.id);  out.put(", ");  out.putDecimal(r.category);  out.put(", ");
+        out.putHex(r.templt);  out.put(", ");  out.putDecimal(r.sourceoperands);  out.put(", ");
+        out.putDecimal(r.op1);  out.put(", ");  out.putDecimal(r.op2);  out.put(", ");
+        out.putHex(r.opimmediate);  out.put(", ");  out.putHex(r.implicit_imm);  out.put(", ");
+        out.putHex(r.optypesgp);  out.put(", ");  out.putHex(r.optypesscalar);  out.put(", ");
+        out.putHex(r.optypesvector);  out.put(", \"");  out.put(r.name);  out.put("\"},");
+        out.newLine();
+    }
+    out.put("};");  out.newLine();  out.newLine();
+    out.put("// sorted by name, by id with an empty record = 0xFFFF first, and by category, format, and op1");
+    out.newLine();
+    putArray(out, "embeddedOrderNm", orderNm);
+    putArray(out, "embeddedOrderId", orderId);
+    putArray(out, "embeddedOrder2", order2);
+
+    // perfect hash table of register names, keywords, and instruction names
+    makeReservedNames(instructionlistNm, reservedNames, reservedHash, reservedSeeds);
+    out.put("// assembler hash table of reserved names: name, length, type, id");  out.newLine();
+    out.put("constexpr SReservedName embeddedReservedNames[");  out.putDecimal(reservedNames.numEntries());
+    out.put("] = {");  out.newLine();
+    for (uint32_t i = 0; i < reservedNames.numEntries(); i++) {
+        SReservedName & r = reservedNames[i];
+        out.put("    {\"");  out.put(r.name);  out.put("\", ");  out.putDecimal(r.length);  out.put(", ");
+        out.putHex(r.type);  out.put(", ");  out.putHex(r.id);  out.put("},");
+        out.newLine();
+    }
+    out.put("};");  out.newLine();  out.newLine();
+    putArray(out, "embeddedReservedHash", reservedHash);
+    putArray(out, "embeddedReservedSeeds", reservedSeeds);
+    out.write(cmd.getFilename(cmd.outputFile));
+}
+
 
 // Interpret a string with a decimal, binary, octal, or hexadecimal number
 int64_t interpretNumber(const char * text, uint32_t maxLength, uint32_t * error) {
@@ -183,6 +183,8 @@ public:
     void getComponents1();                       // Read instruction list, split ELF file into components
     void getComponents2(CELF const & assembler, CMemoryBuffer const & instructList);// Read instruction list, get ELF components for assembler output listing
     void go();                                   // Disassemble
+    void setTabStops();                          // set tab stops for output
+    void initializeInstructionList();            // Read instruction list from file and sort it
     void getLineList(CDynamicArray<SLineRef> & list); // transfer lineList to debugger
     void getOutFile(CTextFileBuffer & buffer);   // transfer outFile to debugger
     CDynamicArray<SInstruction2> & getInstructionList(); // get instructionlist
@@ -237,7 +239,6 @@ protected:
     void updateSymbols();                        // Make missing symbols for jump targets and data references
     void joinSymbolTables();                     // Join the tables: symbols and newSymbols
     void assignSymbolNames();                    // Make names for unnamed symbols
-    void initializeInstructionList();            // Read instruction list from file and sort it
     void updateTracer();                         // Trace registers pointing to jump table (to do)
     void followJumpTable(uint32_t symi, uint32_t RelType); // Trace targets of jump table  (to do)
     void markCodeAsDubious();                    // Mark data in code section
@@ -258,7 +259,6 @@ protected:
     void writeSectionName(int32_t SegIndex);     // Write name of section
     void writePublicsAndExternals();             // Write list of public and external symbols
     void writeAddress();                         // write code address
-    void setTabStops();                          // set tab stops for output
 };
 
 
@@ -328,13 +328,50 @@ static inline bool operator < (SInstruction3 const & a, SInstruction3 const & b)
     return a.id < b.id;
 } 
 
+// struct SReservedName is used for the hash table of register names, keywords, and instruction names
+// in the assembler. The table is included in the embedded instruction list
+struct SReservedName {
+    char name[maxINameLen+1];     // name
+    uint32_t length;              // length of name
+    uint32_t type;                // token type: TOK_REG, TOK_INS, or keyword type
+    uint32_t id;                  // token id
+};
+
+// Make perfect hash table of register names, keywords, and instruction names (in assem1.cpp)
+void makeReservedNames(CDynamicArray<SInstruction> & instructionlistNm, CDynamicArray<SReservedName> & reservedNames, CDynamicArray<uint16_t> & reservedHash, CDynamicArray<uint16_t> & reservedSeeds);
+
 // class for reading comma-separated file
 class CCSVFile : public CFileBuffer {
 public:
     CCSVFile() : CFileBuffer() {}                // Constructor
     void parse();                                // Read and parse file
+    void load();                                 // Get sorted lists. Read file or cache only once
+    void makeHeader();                           // Write C++ header file with sorted lists for embedding in the program
     CDynamicArray<SInstruction> instructionlist; // List of records
+    CDynamicArray<SInstruction> instructionlistNm;// List of records sorted by name
+    CDynamicArray<SInstruction3> instructionlistId; // List of records sorted by id, with an empty record first
+    CDynamicArray<SInstruction2> instructionlist2;// List of records sorted by category, format, and op1
+    CDynamicArray<SReservedName> reservedNames;  // Hash table of reserved names from embedded list. Empty if not embedded
+    CDynamicArray<uint16_t> reservedHash;        // Perfect hash table of reservedNames index + 1
+    CDynamicArray<uint16_t> reservedSeeds;       // Hash seed for each bucket of reservedHash
     uint64_t interpretNumber(const char * text); // Interpret number in instruction list
+protected:
+    void loadFile();                             // Read file or binary cache of file and make sorted lists
+    void sortLists();                            // make sorted lists from instructionlist
+    void listPath(CMemoryBuffer & name);         // make path of instruction list file
+    void cacheName(CMemoryBuffer & name);        // make file name of binary cache
+    bool readCache(const char * name, uint64_t csvHash); // read binary cache. return false if missing or outdated
+    void writeCache(const char * name, uint64_t csvHash); // write binary cache
+};
+
+// Header of binary cache of instruction list file
+struct SInstructionCacheHeader {
+    char     signature[8];                       // "FWCILST"
+    uint32_t recordSize;                         // sizeof(SInstruction)
+    uint32_t numInstructions;                    // number of records in each list
+    uint64_t csvSize;                            // size of instruction list file
+    uint64_t csvHash;                            // hash of instruction list file
+    uint64_t dataHash;                           // hash of the lists that follow the header
 };
 
 // Cross reference of code addresses to lines in outFile. Used by debugger
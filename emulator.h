@@ -54,11 +54,144 @@ const int perf_address_of_first_error = 18;
 const int perf_type_of_first_error = 19;
 const int number_of_perf_counters = 20;          // number of performance counter registers
 
+// phases of emulator run, for timing report
+const int phase_load = 0;                        // read and load executable file
+const int phase_relocate = 1;                    // load-time relocation
+const int phase_disassemble = 2;                 // disassemble for debug output list
+const int phase_setup = 3;                       // prepare tables, buffers, and main thread
+const int phase_execute = 4;                     // run program
+const int num_phases = 5;                        // number of phases
+
 // Indexes into capabilities registers array
 const int disable_errors_capability_register = 2;// register for disabling errors
 const int number_of_capability_registers = 16;   // number of capability registers
+
+// Size of host buffers for files used by system functions
+const uint32_t sys_file_buffer_size = 0x10000;   // buffer size for files opened by emulated program
+const uint32_t sys_stdout_buffer_size = 0x100000;// buffer size for stdout when not writing to a terminal
+const uint32_t sys_format_cache_size = 0x100000; // parsed printf formats are discarded when their text exceeds this size
+
+// record used by the vectored system functions SYSF_FREADV and SYSF_FWRITEV
+struct SIOVector {
+    uint64_t address;                            // address of buffer in emulated memory
+    uint64_t size;                               // size of buffer
+};
+
+// Log of system function results for deterministic record and replay (-record and -replay options).
+// The log file starts with an SReplayHeader. Each system call with a result that depends on the
+// environment is logged as an SReplayRecord followed by numRanges SIOVector records, each
+// followed by the data written to emulated memory, padded to a multiple of 8 bytes
+struct SReplayHeader {
+    char     signature[8];                       // "FWCREPLY"
+    uint64_t fileSize;                           // size of executable file
+    uint64_t fileHash;                           // hash of executable file
+};
+
+struct SReplayRecord {
+    uint32_t function;                           // system function id
+    uint32_t numRanges;                          // number of memory ranges written by the function
+    uint32_t interrupt;                          // interrupt generated by the function, or 0
+    uint32_t unused;                             // alignment filler
+    uint64_t result;                             // return value in r0
+};
+
+// Heap allocator for the system functions SYSF_MALLOC, SYSF_FREE, SYSF_REALLOC (emulator8.cpp).
+// The heap is divided into pages. Small blocks are allocated from pages dedicated to one size class.
+// Large blocks occupy a run of whole pages. All metadata are kept outside the emulated memory
+const uint32_t heap_page_shift = 12;             // log2 of heap page size
+const uint32_t heap_page_size = 1 << heap_page_shift; // heap page size
+const uint32_t heap_num_classes = 16;            // number of size classes for small blocks
+const uint32_t heap_max_small = 2048;            // maximum size of small blocks
+const uint32_t heap_alignment = 16;              // alignment of allocated blocks
+
+// page types in heap page table
+const uint32_t heap_page_unused = 0;             // not used, or part of a block or free run
+const uint32_t heap_page_small = 1;              // page with small blocks. value = size class
+const uint32_t heap_page_large = 2;              // first page of large block. value = number of pages
+const uint32_t heap_page_free = 3;               // first or last page of free run. value = index into heapFreeRuns
+
+// entry in heap page table
+struct SHeapPage {
+    uint32_t type;                               // page type, heap_page_...
+    uint32_t value;                              // depends on type
+};
+
+// run of free pages in heap
+struct SHeapRun {
+    uint32_t page;                               // first page
+    uint32_t num;                                // number of pages
+};
+
+// Breakpoints and watchpoints (emulator9.cpp).
+// Each code or data range with a breakpoint or watchpoint gets its own memory map entry with the
+// corresponding access permission removed. The normal access checks in fetch, readMemoryOperand,
+// and writeMemoryOperand then detect the watched range without any extra cost. The list of
+// breakpoints is searched only when a permission check fails
+const uint32_t debug_break = SHF_EXEC;           // breakpoint on execution of code address
+const uint32_t debug_watch_write = SHF_WRITE;    // watchpoint on memory write
+const uint32_t debug_watch_read = SHF_READ;      // watchpoint on memory read
+const uint8_t  debug_no_condition = 0xFF;        // condition register when there is no condition
+const uint16_t debug_action_report = 0;          // write registers to stdout when hit
+const uint16_t debug_action_gdb = 1;             // set by GDB. stop and report to GDB when hit
+const uint16_t debug_action_list = 2;            // start debug listing when hit (-listat option)
+
+// breakpoint or watchpoint
+struct SDebugPoint {
+    uint64_t address;                            // code address or start of watched data range
+    uint64_t end;                                // end of watched data range
+    uint64_t value;                              // value to compare with condition register
+    uint64_t hits;                               // number of times hit
+    uint32_t type;                               // debug_break, debug_watch_write, debug_watch_read, or a combination
+    uint32_t name;                               // text from command line, as offset into CEmulator::debugNames
+    uint8_t  reg;                                // condition register. debug_no_condition if none
+    uint8_t  notEqual;                           // condition is reg != value, otherwise reg == value
+    uint16_t action;                             // what to do when hit: debug_action_...
+};
+
+// GDB remote serial protocol stub (emulator10.cpp).
+// GDB register numbers: r0-r31 = 0-31, ip = 32, v0-v31 = 33-64
+const uint32_t gdb_reg_ip = 32;                  // GDB register number of instruction pointer
+const uint32_t gdb_reg_v0 = 33;                  // GDB register number of first vector register
+const uint32_t gdb_num_regs = 65;                // number of GDB registers
+const uint32_t gdb_poll_interval = 0x10000;      // number of instructions between checks for interrupt from GDB
+
 class CEmulator;                                 // preliminary declaration
 
+// structure for library function replaced by native high-level emulation (emulator7.cpp)
+struct SHleEntry {
+    uint64_t address;                            // address of function entry
+    uint32_t function;                           // index into table of native functions
+    uint32_t unused;                             // alignment filler
+};
+
+// operator < for sorting and searching list of native functions by address
+static inline bool operator < (SHleEntry const & a, SHleEntry const & b) {
+    return a.address < b.address;
+}
+
+// directive in parsed printf format string, used by CThread::formatEmulated
+struct SFormatDirective {
+    uint32_t text;                               // offset into formatStrings of substring with one format specifier and following text
+    uint32_t trailing;                           // position of text following the format specifier, relative to substring
+    uint8_t  type;                               // argument type. 0 = integer or none, 1 = string, 2 = floating point
+    uint8_t  asterisks;                          // number of '*' in format specifier = extra arguments
+    uint16_t unused;                             // alignment filler
+};
+
+// parsed printf format string, identified by its address in emulated memory
+struct SFormatCache {
+    uint64_t address;                            // address of format string
+    uint32_t first;                              // index of first directive in formatDirectives
+    uint32_t num;                                // number of directives
+    uint32_t source;                             // offset into formatStrings of copy of original format if writeable
+    uint32_t writeable;                          // format string is in writeable memory and may change
+};
+
+// operator < for searching format cache by address
+static inline bool operator < (SFormatCache const & a, SFormatCache const & b) {
+    return a.address < b.address;
+}
+
 // Class for a thread or CPU core in the emulator
 class CThread {
 public:
@@ -122,9 +255,36 @@ public:
     void writeMemoryOperand(uint64_t val, uint64_t address);  // write a memory operand
     void interrupt(uint32_t n);                  // interrupt or trap
     uint64_t checkSysMemAccess(uint64_t address, uint64_t size, uint8_t rd, uint8_t rs, uint8_t mode);
-    int fprintfEmulated(FILE * stream, const char * format, uint64_t * argumentList); // emulate fprintf with ForwardCom argument list
+    int fprintfEmulated(FILE * stream, uint64_t format, uint64_t argumentList); // emulate fprintf with ForwardCom argument list
+    int formatEmulated(uint64_t format, uint64_t argumentList); // emulate sprintf with ForwardCom argument list. output to printBuffer
+    uint32_t parseFormat(uint64_t format);       // parse printf format string into directives, cached by address
+    CMemoryBuffer printBuffer;                   // output from formatEmulated
+    uint64_t fileVectorIO(uint64_t iovAddress, uint64_t num, FILE * file, bool write, uint8_t rd, uint8_t rs); // read or write multiple buffers
+    void recordRange(uint64_t address, uint64_t size) { // remember memory range written by system function when recording
+        if (recording && size) {SIOVector r = {address, size}; replayRanges.push(r);}
+    }
+    void recordSystemCall(uint32_t funcid);      // log result of system function
+    void replaySystemCall(uint32_t funcid);      // get result of system function from log
+    bool recording;                              // recording system function results
+    bool replaying;                              // replaying recorded system function results
+    uint32_t replayInterrupt;                    // interrupt generated during recorded system function
+    CDynamicArray<SIOVector> replayRanges;       // memory ranges written by current system function
     // check if system function has access to a particular address
     void systemCall(uint32_t mod, uint32_t funcid, uint8_t rd, uint8_t rs); // entry for system calls
+    bool hleCall();                              // run native version of library function at ip, if any
+    bool debugAccess(uint64_t address, uint64_t size, uint32_t mode); // check breakpoints and watchpoints when access permission fails
+    void debugHit(uint32_t i, uint64_t address, uint32_t mode); // report breakpoint or watchpoint number i
+    bool debugSuspend;                           // don't check watchpoints while listing results
+    uint32_t terminateInterrupt;                 // interrupt that terminated execution
+    uint32_t gdbSignal;                          // signal number for stopping and reporting to GDB. 0 if running
+    uint32_t gdbWatchType;                       // type of watchpoint hit, debug_watch_...
+    uint64_t gdbWatchAddress;                    // address of watchpoint hit
+    uint64_t gdbIgnoreAddress;                   // don't stop at GDB breakpoint here when resuming
+    void gdbRun();                               // run under control of GDB
+    bool gdbStopped();                           // report stop to GDB and process commands until continue
+    bool gdbCommand(bool & resume);              // process one command from GDB
+    void gdbUpdateMap();                         // update memory map after breakpoints changed
+    uint64_t gdbRegister(uint32_t reg, char * hex, bool write); // read or write register in hexadecimal
     uint64_t makeNan(uint32_t code, uint32_t operandType);// make a NaN with exception code and address in payload
     CDynamicArray<uint64_t> callStack;           // stack of return addresses
     uint32_t callDept;                           // maximum number of entries observed in callStack
@@ -145,6 +305,12 @@ protected:
     void execute();                              // execute current instruction
     void listStart();                            // start writing debug list
     void listInstruction(uint64_t address);      // write current instruction to debug list
+    void listLine(uint64_t address);             // write disassembly of instruction to debug list
+    void listResume();                           // start deferred debug listing
+    bool listFlushRing();                        // write instructions saved in listRing to debug list
+    CDynamicArray<uint64_t> listRing;            // circular buffer of addresses of last instructions (-listlast option)
+    uint32_t listRingPos;                        // next position in listRing
+    uint32_t listRingNum;                        // number of valid entries in listRing
 public:
     void listResult(uint64_t result);            // write result of current instruction to debug list
     void performanceCounters();                  // update performance counters
@@ -173,7 +339,31 @@ protected:
     void load();                                 // load executable file into memory
     void relocate();                             // relocate any absolute addresses and system function id's
     void disassemble();                          // make disassembly listing for debug output
+    uint32_t lineIndex(uint64_t address);        // find address in lineList. return lineList.numEntries() if not found
     void updateNumOperands();                    // update numOperands table from instruction_list.csv
+    void ioSetup();                              // set up host buffers for standard output
+    void hleSetup();                             // find library functions that can be replaced by native versions
+    void hleReport();                            // write statistics of native library function calls
+    void heapSetup(uint64_t start);              // initialize heap allocator
+    uint64_t heapAlloc(uint64_t size);           // allocate block on heap. return 0 if failed
+    bool heapFree(uint64_t address);             // free block on heap. return false if address is invalid
+    bool heapRealloc(uint64_t & address, uint64_t size); // resize block on heap. return false if address is invalid
+    uint64_t heapBlockSize(uint64_t address);    // size of allocated block on heap. 0 if invalid
+    void heapReport();                           // write heap statistics
+    void replaySetup();                          // prepare recording or replay of system function results
+    void replayFinish();                         // save recorded system function results
+    void perfReport();                           // report speed and time used in each phase
+    void phaseEnd(int phase);                    // add time since last call to phase
+    void debugSetup();                           // set up breakpoints and watchpoints from command line
+    void debugParse(const char * list, uint32_t type, uint16_t action); // interpret list of breakpoints or watchpoints
+    void debugProtect(uint64_t start, uint64_t end, uint32_t permissions); // remove access permissions from address range
+    bool symbolAddress(const char * name, uint64_t & address); // find address of symbol in memory
+    void debugUpdateMap();                       // remove access permissions for all breakpoints from memory map
+    double phaseTimes[num_phases];               // wall time used in each phase of emulator run
+    double phaseCpuTimes[num_phases];            // CPU time used in each phase of emulator run
+    uint64_t phasePeaks[num_phases];             // peak size of allocated buffers in each phase
+    double phaseWall0, phaseCpu0;                // time at end of last phase
+    double totalCpuTime;                         // CPU time used by emulator
     uint32_t MaxVectorLength;                    // maximum vector length
     int8_t * memory;                             // program memory
     uint64_t memsize;                            // total allocated memory size
@@ -190,7 +380,38 @@ protected:
     CDynamicArray<SMemoryMap> memoryMap;         // main memory map
     CDynamicArray<SLineRef> lineList;            // Cross reference of code addresses to lines in dissassembler output
     CTextFileBuffer disassemOut;                 // Output file from disassembler
+    CDynamicArray<uint32_t> lineHash;            // hash table of lineList index + 1 by address. 0 = vacant
+    bool disassembled;                           // disassembly for debug listing has been made
     CDisassembler disassembler;                  // disassembler for producing output list
+    CDynamicArray<SHleEntry> hleList;            // library functions replaced by native versions, sorted by address
+    CDynamicArray<uint64_t> hleCalls;            // number of calls to each native library function
+    CDynamicArray<SFormatCache> formatCache;     // parsed printf format strings, sorted by address
+    CDynamicArray<SFormatDirective> formatDirectives; // directives in parsed format strings
+    CMemoryBuffer formatStrings;                 // substrings of parsed format strings
+    uint32_t lastFormat;                         // index into formatCache of last used format
+    uint64_t hleMin;                             // lowest address in hleList
+    uint64_t hleMax;                             // highest address in hleList
+    CFileBuffer replayLog;                       // log of system function results for -record and -replay
+    uint32_t replayPos;                          // current position in replayLog
+    CDynamicArray<SDebugPoint> debugPoints;      // breakpoints and watchpoints
+    CDynamicArray<SMemoryMap> debugMap;          // memory map with the original access permissions
+    CMemoryBuffer debugNames;                    // text of breakpoints and watchpoints
+    uint32_t debugMaxLines;                      // maximum number of lines in debug listing when deferred listing starts
+    uint64_t debugCodeBase;                      // start of first code section. code addresses in listing are relative to this
+    uint64_t heapStart;                          // address of heap
+    uint32_t heapTop;                            // first heap page never used
+    uint32_t heapTopPeak;                        // maximum value of heapTop = high-water mark in pages
+    uint64_t heapInUse;                          // number of bytes currently allocated on heap, including padding
+    uint64_t heapPeak;                           // maximum value of heapInUse
+    uint64_t heapCalls[4];                       // number of calls to malloc, free, realloc, and failed allocations
+    CDynamicArray<SHeapPage> heapPages;          // heap page table
+    CDynamicArray<SHeapRun> heapFreeRuns;        // runs of free pages, not sorted
+    CDynamicArray<uint64_t> heapFreeBlocks[heap_num_classes]; // free small blocks of each size class
+    CDynamicArray<uint64_t> heapUsedBits;        // bitmap of allocated small blocks, 4 words per page
+    uint32_t heapAllocPages(uint32_t num);       // allocate run of pages on heap
+    void heapFreePages(uint32_t page, uint32_t num); // free run of pages on heap
+    void heapRemoveFreeRun(uint32_t i);          // remove entry from heapFreeRuns
+    void heapTagFreeRun(uint32_t i);             // mark first and last page of free run
     friend class CThread;
 };
 
@@ -27,33 +27,127 @@ CEmulator::CEmulator() {
     maxNumThreads = 1;                           // multithreading not supported yet
     stackSize = 0x100000;                        // 1 MB. data stack size for main thread
     callStackSize = 0x800;                       // call stack size for main thread
-    heapSize = 0;                                // heap size for main thread
+    heapSize = 0x100000;                         // 1 MB. heap size for malloc system function
+    lastFormat = 0;                              // index into formatCache
+    hleMin = ~uint64_t(0);                       // no native library functions
+    hleMax = 0;
+    heapStart = 0;
+    replayPos = 0;
+    debugMaxLines = 0;
+    debugCodeBase = 0;
+    disassembled = false;
+    totalCpuTime = 0;
+    for (int i = 0; i < num_phases; i++) {
+        phaseTimes[i] = phaseCpuTimes[i] = 0;  phasePeaks[i] = 0;
+    }
+    phaseWall0 = phaseCpu0 = 0;
     environmentSize = 0x100;                     // maximum size of environment and command line data
 }
 
 // destructor
 CEmulator::~CEmulator() {
-    if (memory) delete[] memory;                 // free allocated program memory
+    if (memory) {
+        delete[] memory;                         // free allocated program memory
+        CMemoryBuffer::countSize(-(int64_t)memsize);
+    }
 }
 
+// names of phases for timing reports
+static const char * phaseNames[num_phases] = {"load", "relocate", "disassemble", "setup", "execute"};
+
 // start
 void CEmulator::go() {
+    double startCpuTime = cpuTime();             // for timing report
+    phaseWall0 = wallTime();  phaseCpu0 = startCpuTime;
     threads.setSize(maxNumThreads);              // initialize threads
     load();                                      // load executable file
+    phaseEnd(phase_load);
     if (err.number()) return;
     if (fileHeader.e_flags & EF_RELOCATE) relocate();
+    phaseEnd(phase_relocate);
     if (err.number()) return;
 
-    // set up disassembler for output list
-    if (cmd.outputListFile) disassemble();
+    // set up disassembler for output list. The disassembly is made when the first line is listed
+    if (cmd.outputListFile) {
+        disassembler.debugMode = 1;
+        disassembler.setTabStops();              // tab stops are needed before the disassembly
+        disassembler.initializeInstructionList(); // needed by updateNumOperands
+    }
 
     // update list of number of operands and other attributes of instructions
     updateNumOperands();
 
+    // find library functions to replace by native versions
+    if (cmd.hleList) hleSetup();
+    if (err.number()) return;
+
+    // set up buffers for input and output
+    ioSetup();
+
+    // prepare recording or replay of system function results
+    replaySetup();
+    if (err.number()) return;
+
+    // set up breakpoints and watchpoints
+    if (cmd.breakList || cmd.watchList || cmd.gdbPort || cmd.listAt || cmd.listStartCount || cmd.listLast) debugSetup();
+    if (err.number()) return;
+
     // prepare main thread
     threads[0].setRegisters(this);
+    phaseEnd(phase_setup);
     // run main thread
-    threads[0].run();
+    if (cmd.gdbPort) threads[0].gdbRun();        // under control of GDB
+    else threads[0].run();
+    fflush(stdout);                              // write buffered output before any reports
+    phaseEnd(phase_execute);
+    replayFinish();                              // save recorded system function results
+    totalCpuTime = cpuTime() - startCpuTime;
+    // the same phase times are used for -timings and -perf
+    for (int i = 0; i < num_phases; i++) {
+        timingStage(phaseNames[i], phaseTimes[i], phaseCpuTimes[i], phasePeaks[i]);
+    }
+
+    // emulator speed and time used
+    if (cmd.emulateOptions & CMDL_EMU_PERF) perfReport();
+
+    // statistics of native library functions
+    if (cmd.hleList) hleReport();
+    // heap statistics
+    if (cmd.emulateOptions & CMDL_EMU_HEAPSTAT) heapReport();
+}
+
+// add the time since the last call to a phase. A phase may be divided into parts
+void CEmulator::phaseEnd(int phase) {
+    double wall = wallTime(), cpu = cpuTime();
+    phaseTimes[phase] += wall - phaseWall0;
+    phaseCpuTimes[phase] += cpu - phaseCpu0;
+    if (CMemoryBuffer::peakSize > phasePeaks[phase]) phasePeaks[phase] = CMemoryBuffer::peakSize;
+    CMemoryBuffer::peakSize = CMemoryBuffer::totalSize;  // next phase begins here
+    phaseWall0 = wall;  phaseCpu0 = cpu;
+}
+
+// report number of instructions executed, speed, and time used in each phase
+void CEmulator::perfReport() {
+    uint64_t instructions = threads[0].ninstructions + threads[0].perfCounters[perf_instructions];
+    double totalWallTime = 0;
+    for (int i = 0; i < num_phases; i++) totalWallTime += phaseTimes[i];
+    // million instructions per second during execution
+    double mips = phaseTimes[phase_execute] > 0. ? instructions * 1.E-6 / phaseTimes[phase_execute] : 0.;
+    if (cmd.emulateOptions & CMDL_EMU_PERF_JSON) {
+        printf("\n{\"instructions\": %llu, \"wall_time\": %.6f, \"cpu_time\": %.6f, \"mips\": %.3f, \"phases\": {",
+            (unsigned long long)instructions, totalWallTime, totalCpuTime, mips);
+        for (int i = 0; i < num_phases; i++) {
+            printf("%s\"%s\": %.6f", i ? ", " : "", phaseNames[i], phaseTimes[i]);
+        }
+        printf("}}\n");
+        return;
+    }
+    printf("\nEmulated %llu instructions in %.3f s wall time, %.3f s CPU time, %.2f MIPS",
+        (unsigned long long)instructions, totalWallTime, totalCpuTime, mips);
+    printf("\nTime used:");
+    for (int i = 0; i < num_phases; i++) {
+        printf(" %s %.3f s%s", phaseNames[i], phaseTimes[i], i + 1 < num_phases ? "," : "\n");
+    }
 }
 
 // load executable file into memory
@@ -113,7 +207,9 @@ void CEmulator::load() {
     align = (uint64_t)1 << MEMORY_MAP_ALIGN;
     memsize = (memsize + align - 1) & -(int64_t)align;
     // add stack and heap
-    memsize += stackSize + heapSize;
+    if (cmd.heapSizeOption) heapSize = cmd.heapSizeOption;
+    heapSize &= ~uint64_t(heap_page_size - 1);   // heap size must be a multiple of the heap page size
+    memsize += stackSize + heapSize + heap_alignment;
     // allocate memory
     memory = new int8_t[size_t(memsize)];
     if (!memory) {
@@ -121,6 +217,7 @@ void CEmulator::load() {
         return;
     }
     memset(memory, 0, size_t(memsize));
+    CMemoryBuffer::countSize((int64_t)memsize);  // include program memory in timing report
     // start making memory map
     address = 0;  
     flags = SHF_READ | SHF_IP;  lastflags = flags;
@@ -175,6 +272,16 @@ void CEmulator::load() {
         address += programHeaders[ph].p_memsz;
         lastflags = flags;
     }
+    // make heap after last data section
+    address = (address + heap_alignment - 1) & -(int64_t)heap_alignment;
+    if (address + heapSize > memsize) heapSize = 0;
+    if (heapSize) {
+        mapentry.startAddress = address;
+        mapentry.access_addend = SHF_READ | SHF_WRITE;
+        memoryMap.push(mapentry);
+        heapSetup(address);
+        address += heapSize;
+    }
     // make terminating entry
     mapentry.startAddress = address;
     mapentry.access_addend = 0;
@@ -283,6 +390,8 @@ void CEmulator::relocate() {
 }
 
 void CEmulator::disassemble() {              // make disassembly listing for debug output
+    phaseEnd(phase_execute);                 // disassembly is made during execution
+    disassembled = true;
     disassembler.copy(*this);                // copy ELF file
     disassembler.getComponents1();           // set up instruction list, etc.
     if (err.number()) return;
@@ -297,6 +406,32 @@ void CEmulator::disassemble() {              // make disassembly listing for deb
     for (uint32_t i = 0; i < disassemOut.dataSize(); i++) {
         if ((uint8_t)disassemOut.buf()[i] < ' ') disassemOut.buf()[i] = 0;
     }
+    // make hash table of lineList. size is a power of 2, at least twice the number of entries
+    uint32_t size = 16;
+    while (size < lineList.numEntries() * 2) size <<= 1;
+    lineHash.setNum(size);
+    for (uint32_t i = 0; i < lineList.numEntries(); i++) {
+        if (lineList[i].domain != 1) continue;
+        uint32_t h = (uint32_t)((lineList[i].address >> 2) * 0x9E3779B1u) & (size - 1);
+        while (lineHash[h]) {
+            if (lineList[lineHash[h]-1].address == lineList[i].address) break;   // keep first of duplicates
+            h = (h + 1) & (size - 1);
+        }
+        if (lineHash[h] == 0) lineHash[h] = i + 1;
+    }
+    phaseEnd(phase_disassemble);
+}
+
+// find address in lineList. return lineList.numEntries() if not found
+uint32_t CEmulator::lineIndex(uint64_t address) {
+    uint32_t size = lineHash.numEntries();
+    if (size == 0) return lineList.numEntries();
+    uint32_t h = (uint32_t)((address >> 2) * 0x9E3779B1u) & (size - 1);
+    while (lineHash[h]) {
+        if (lineList[lineHash[h]-1].address == address) return lineHash[h] - 1;
+        h = (h + 1) & (size - 1);
+    }
+    return lineList.numEntries();
 }
 
 void CEmulator::updateNumOperands() {        
@@ -380,7 +515,15 @@ CThread::CThread() {
     mapIndex1 = mapIndex2 = mapIndex3 = 0;                 // indexes into memory map
     callDept = 0;
     listLines = 0;
+    listRingPos = listRingNum = 0;
     tempBuffer = 0;
+    recording = replaying = false;
+    replayInterrupt = 0;
+    debugSuspend = false;
+    terminateInterrupt = 0;
+    gdbSignal = gdbWatchType = 0;
+    gdbWatchAddress = 0;
+    gdbIgnoreAddress = ~uint64_t(0);
 }
 
 // destructor
@@ -407,6 +550,8 @@ void CThread::setRegisters(CEmulator * emulator) {
     vectors.setDataSize(32*MaxVectorLength);
     registers[31] = emulator->stackp;                      // stack pointer
     memset(perfCounters, 0, sizeof(perfCounters));         // reset performance counters
+    recording = cmd.recordFile != 0;                       // record or replay system function results
+    replaying = cmd.replayFile != 0;
     // initialize capability registers
     memset(capabilyReg, 0, sizeof(capabilyReg));           // reset capability registers
     capabilyReg[0] = 'E';                                  // brand ID. E = emulator
@@ -418,6 +563,10 @@ void CThread::setRegisters(CEmulator * emulator) {
     capabilyReg[14] = MaxVectorLength;                     // maximum block size for permute??
     capabilyReg[15] = MaxVectorLength;                     // maximum vector length compress_sparse and expand_sparse    
     listFileName = cmd.outputListFile;                     // name for output list file. to do: add thread number to list file name if multiple threads
+    if (listFileName && cmd.listLast) {                    // circular buffer for last instructions before an interrupt
+        listRing.setNum(cmd.listLast);
+        listRing.zero();
+    }
 }
 
 // start running
@@ -425,6 +574,8 @@ void CThread::run() {
     listStart();                                 // start writing debug output list
     running = 1;  terminate = false;
     while (running && !terminate) {
+        // check for library function replaced by native version
+        if (emulator->hleList.numEntries() && hleCall()) continue;
 
         fetch();                                 // fetch next instruction
         if (terminate) break;
@@ -461,8 +612,8 @@ void CThread::fetch() {
             interrupt(INT_ACCESS_EXE);  return;
         }
     }
-    // check execute permission
-    if (!(memoryMap[mapIndex1].access_addend & SHF_EXEC)) interrupt(INT_ACCESS_EXE);
+    // check execute permission. breakpoints are in code without execute permission
+    if (!(memoryMap[mapIndex1].access_addend & SHF_EXEC) && !debugAccess(ip, 4, SHF_EXEC)) interrupt(INT_ACCESS_EXE);
     // get instruction
     pInstr = (STemplate const *)(memory + ip);
 }
@@ -474,7 +625,8 @@ static const uint8_t lengthList[8] = {1,1,1,1,2,2,3,4};
 void CThread::decode() {
     uint32_t operandOptions = 0;  // number of operands and options from numOperands tables in format_tables.cpp
 
-    listInstruction(ip - ip0);            // make debug listing
+    // make debug listing. instructions outside the listing window skip the call unless they must be counted or remembered
+    if (listFileName && (cmd.maxLines || cmd.listStartCount || cmd.listLast)) listInstruction(ip - ip0);
     // decoding similar to CDisassembler::parseInstruction()
     op = pInstr->a.op1;
 
@@ -906,7 +1058,7 @@ void CThread::execute() {
             vect ^= 3;                                     // toggle between 1 for even elements, 2 for odd
             if (doubleStep) vectorOffset += elementSize;   // skip next element if instruction takes two elements at a time            
         }
-        listResult(result);                                // debug output
+        if (listFileName && cmd.maxLines) listResult(result); // debug output
     }
     else {
         // general purpose registers
@@ -931,7 +1083,7 @@ void CThread::execute() {
         // get mask for operand size (operandType may have been changed by function)
         // store in destination register, zero extended from operand size
         if (running & 1) registers[operands[0]] = result & dataSizeMask[operandType];
-        listResult(result);                                // debug output
+        if (listFileName && cmd.maxLines) listResult(result); // debug output
     }
     performanceCounters();  // update performance counters
 }
@@ -1124,15 +1276,14 @@ uint64_t CThread::readMemoryOperand(uint64_t address) {
             interrupt(INT_ACCESS_READ);  return 0;
         }
     }
-    // check read permission
-    if (!(memoryMap[index].access_addend & SHF_READ)) {
-        interrupt(INT_ACCESS_READ);  return 0;
-    }
-
-    // check if map boundary crossed
-    if (address + dataSizeTable[operandType] > memoryMap[index+1].startAddress
-    && !(memoryMap[index+1].access_addend & SHF_READ)) {
+    // check read permission and check if map boundary crossed.
+    // watched memory ranges have no read permission
+    bool denied = !(memoryMap[index].access_addend & SHF_READ);
+    if ((denied || (address + dataSizeTable[operandType] > memoryMap[index+1].startAddress
+    && !(memoryMap[index+1].access_addend & SHF_READ)))
+    && !debugAccess(address, dataSizeTable[operandType], SHF_READ)) {
         interrupt(INT_ACCESS_READ);
+        if (denied) return 0;
     }
 
     // check alignment ?
@@ -1176,15 +1327,14 @@ void CThread::writeMemoryOperand(uint64_t val, uint64_t address) {
             interrupt(INT_ACCESS_WRITE);  return;
         }
     }
-    // check write permission
-    if (!(memoryMap[mapIndex3].access_addend & SHF_WRITE)) {
-        interrupt(INT_ACCESS_WRITE);  return;
-    }
-
-    // check if map boundary crossed
-    if (address + dataSizeTable[operandType] > memoryMap[mapIndex3+1].startAddress
-    && !(memoryMap[mapIndex3+1].access_addend & SHF_WRITE)) {
+    // check write permission and check if map boundary crossed.
+    // watched memory ranges have no write permission
+    bool denied = !(memoryMap[mapIndex3].access_addend & SHF_WRITE);
+    if ((denied || (address + dataSizeTable[operandType] > memoryMap[mapIndex3+1].startAddress
+    && !(memoryMap[mapIndex3+1].access_addend & SHF_WRITE)))
+    && !debugAccess(address, dataSizeTable[operandType], SHF_WRITE)) {
         interrupt(INT_ACCESS_WRITE);
+        if (denied) return;
     }
 
     // write value
@@ -1229,10 +1379,56 @@ void CThread::listStart() {
     }
 }
 
-static uint32_t listIndex = 0;                   // index into lineList
+// start deferred debug listing
+void CThread::listResume() {
+    if (emulator->debugMaxLines) {
+        cmd.maxLines = emulator->debugMaxLines;
+        emulator->debugMaxLines = 0;
+        listLines = 0;
+    }
+}
+
 // write current instruction to debug list
 void CThread::listInstruction(uint64_t address) {
-    if (listFileName == 0 || cmd.maxLines == 0) return;    // stop listing
+    if (listFileName == 0) return;               // no debug list
+    if (cmd.maxLines == 0) {                     // outside the listing window
+        if (cmd.listStartCount && ninstructions + perfCounters[perf_instructions] >= cmd.listStartCount) {
+            cmd.listStartCount = 0;              // start listing after a number of instructions
+            listResume();
+        }
+        if (cmd.maxLines == 0) {
+            if (cmd.listLast) {                  // remember address in circular buffer
+                ((uint64_t*)listRing.buf())[listRingPos] = address;
+                if (++listRingPos >= cmd.listLast) listRingPos = 0;
+                if (listRingNum < cmd.listLast) listRingNum++;
+            }
+            return;
+        }
+    }
+    listLine(address);
+}
+
+// write instructions saved in listRing to debug list. return false if empty
+bool CThread::listFlushRing() {
+    if (listRingNum == 0) return false;
+    listOut.newLine();
+    listOut.tabulate(emulator->disassembler.asmTab0);
+    listOut.put("last ");
+    listOut.putDecimal(listRingNum);
+    listOut.put(" instructions:");
+    listOut.newLine();
+    uint32_t pos = listRingPos >= listRingNum ? listRingPos - listRingNum : listRingPos + cmd.listLast - listRingNum;
+    for (uint32_t i = 0; i < listRingNum; i++) {
+        listLine(listRing[pos]);
+        if (++pos >= cmd.listLast) pos = 0;
+    }
+    listRingNum = listRingPos = 0;
+    return true;
+}
+
+static uint32_t listIndex = 0;                   // index into lineList
+// write disassembly of instruction to debug list
+void CThread::listLine(uint64_t address) {
     SLineRef rec = {address, 1, 0};
     const char * text = 0;
     if (listIndex + 1 < emulator->lineList.numEntries() && emulator->lineList[listIndex+1] == rec) {
@@ -1240,7 +1436,8 @@ void CThread::listInstruction(uint64_t address) {
         listIndex = listIndex+1;
     }
     else {  // we may have jumped. Find address in list
-        listIndex = (uint32_t)emulator->lineList.findFirst(rec);
+        if (!emulator->disassembled) emulator->disassemble(); // make disassembly when first needed
+        listIndex = emulator->lineIndex(address);
     }
     if (listIndex < emulator->lineList.numEntries()) {
         text = emulator->disassemOut.getString(emulator->lineList[listIndex].textPos); // get line from disassembly
@@ -1259,6 +1456,7 @@ void CThread::listResult(uint64_t result) {
     if (++listLines >= cmd.maxLines) cmd.maxLines = 0;  // stop listing 
     if (listFileName == 0 || returnType == 0 || cmd.maxLines == 0) return;      // nothing if no list file or no return value
     listOut.tabulate(emulator->disassembler.asmTab0);
+    debugSuspend = true;                         // reading memory for the listing is not a watched access
     if (!(returnType & 0x100)) { // general purpose register
         if (returnType & 0x20) { // memory destination
             result = readMemoryOperand(getMemoryAddress());
@@ -1326,6 +1524,7 @@ void CThread::listResult(uint64_t result) {
             listOut.put(' ');
         }
     }
+    debugSuspend = false;
     if (returnType & 0x3000) {
         // conditional jump instruction
         if (returnType & 0x30) listOut.put(",  ");    // space after value
@@ -0,0 +1,508 @@
+/****************************  emulator10.cpp  *******************************
+* Author:        Agner Fog
+* date created:  2026-10-18
+* Last modified: 2026-10-18
+* Version:       1.14
+* Project:       Binary tools for ForwardCom instruction set
+* Description:
+* Emulator: Stub for the GDB remote serial protocol
+*
+* The command line option -gdb=port makes the emulator wait for a connection
+* from a debugger on localhost and run the program under its control.
+* Supported commands: read and write registers and memory, single step,
+* continue, interrupt, software breakpoints, and watchpoints.
+* Breakpoints and watchpoints use the same memory map mechanism as the
+* -break and -watch options (emulator9.cpp).
+* The registers are described to the debugger by a target description in XML:
+* r0-r31 = register 0-31, ip = 32, v0-v31 = 33-64. Vector registers have the
+* maximum vector length.
+* Addresses are absolute addresses in emulated memory.
+*
+* Copyright 2018-2026 GNU General Public License http://www.gnu.org/licenses
+*****************************************************************************/
+
+#if defined(_WIN32) || defined(__WINDOWS__)
+#include <winsock2.h>                            // must be included before windows.h
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET gdbSocket_t;
+#define GDB_INVALID_SOCKET INVALID_SOCKET
+#define gdbCloseSocket closesocket
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int gdbSocket_t;
+#define GDB_INVALID_SOCKET (-1)
+#define gdbCloseSocket close
+#endif
+
+#include "stdafx.h"
+
+// connection to debugger. The emulator has only one debugger connection
+static gdbSocket_t gdbSocket = GDB_INVALID_SOCKET;
+static char gdbReceiveBuffer[1024];              // data received from debugger
+static uint32_t gdbReceivePos = 0;               // position of next unread byte in gdbReceiveBuffer
+static uint32_t gdbReceiveNum = 0;               // number of bytes in gdbReceiveBuffer
+static CMemoryBuffer gdbPacket;                  // last packet received, zero-terminated
+static CMemoryBuffer gdbReply;                   // reply being built
+static CMemoryBuffer gdbTargetXml;               // target description
+static bool gdbStepping = false;                 // single step command
+static bool gdbResumed = false;                  // execution has been resumed by debugger. stop must be reported
+static uint32_t gdbLastSignal = 5;               // signal of last stop
+
+static const char hexDigits[] = "0123456789abcdef";
+
+// value of hexadecimal digit. -1 if not a hexadecimal digit
+static int gdbHexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// read hexadecimal number and advance pointer
+static uint64_t gdbReadHex(const char * & p) {
+    uint64_t x = 0;
+    int d;
+    while ((d = gdbHexValue(*p)) >= 0) {
+        x = x << 4 | d;  p++;
+    }
+    return x;
+}
+
+// add bytes as hexadecimal to reply
+static void gdbPutHexBytes(const void * data, uint32_t size) {
+    for (uint32_t i = 0; i < size; i++) {
+        uint8_t b = ((const uint8_t*)data)[i];
+        char h[2] = {hexDigits[b >> 4], hexDigits[b & 15]};
+        gdbReply.push(h, 2);
+    }
+}
+
+// add text to reply
+static void gdbPutText(const char * text) {
+    gdbReply.push(text, (uint32_t)strlen(text));
+}
+
+// read one character from debugger. wait = false: return -1 if nothing received yet.
+// return -2 if the connection is closed
+static int gdbGetChar(bool wait) {
+    if (gdbReceivePos >= gdbReceiveNum) {
+        if (!wait) {
+            // check if anything has been received
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(gdbSocket, &readSet);
+            struct timeval timeout = {0, 0};
+            if (select((int)gdbSocket + 1, &readSet, 0, 0, &timeout) <= 0) return -1;
+        }
+        int n = recv(gdbSocket, gdbReceiveBuffer, sizeof(gdbReceiveBuffer), 0);
+        if (n <= 0) return -2;
+        gdbReceivePos = 0;  gdbReceiveNum = n;
+    }
+    return (uint8_t)gdbReceiveBuffer[gdbReceivePos++];
+}
+
+// send reply as a packet and wait for acknowledgement
+static bool gdbSendReply() {
+    uint8_t checksum = 0;
+    for (uint32_t i = 0; i < gdbReply.dataSize(); i++) checksum += (uint8_t)gdbReply.buf()[i];
+    char tail[3] = {'#', hexDigits[checksum >> 4], hexDigits[checksum & 15]};
+    while (true) {
+        send(gdbSocket, "$", 1, 0);
+        if (gdbReply.dataSize()) send(gdbSocket, gdbReply.buf(), gdbReply.dataSize(), 0);
+        send(gdbSocket, tail, 3, 0);
+        int c = gdbGetChar(true);
+        if (c == '+') return true;
+        if (c != '-') return false;              // connection closed. '-' means resend
+    }
+}
+
+// send reply consisting of text
+static bool gdbSend(const char * text) {
+    gdbReply.setDataSize(0);
+    gdbPutText(text);
+    return gdbSendReply();
+}
+
+// receive packet into gdbPacket. return 3 for interrupt, 1 for packet, 0 if connection closed
+static int gdbGetPacket() {
+    while (true) {
+        int c = gdbGetChar(true);
+        if (c == -2) return 0;
+        if (c == 3) return 3;                    // interrupt
+        if (c != '$') continue;                  // ignore acknowledgements etc.
+        gdbPacket.setDataSize(0);
+        uint8_t checksum = 0;
+        while ((c = gdbGetChar(true)) != '#') {
+            if (c < 0) return 0;
+            char ch = (char)c;
+            gdbPacket.push(&ch, 1);
+            checksum += (uint8_t)c;
+        }
+        int h1 = gdbGetChar(true), h2 = gdbGetChar(true);
+        if (h1 < 0 || h2 < 0) return 0;
+        gdbPacket.push("", 1);                   // zero-terminate
+        if (gdbHexValue((char)h1) * 16 + gdbHexValue((char)h2) == checksum) {
+            send(gdbSocket, "+", 1, 0);
+            return 1;
+        }
+        send(gdbSocket, "-", 1, 0);              // checksum error. ask for resend
+    }
+}
+
+// make target description
+static void gdbMakeTargetXml(uint32_t maxVectorLength) {
+    char line[256];
+    gdbTargetXml.setDataSize(0);
+    const char * head = "<?xml version=\"1.0\"?>\n<!DOCTYPE target SYSTEM \"gdb-target.dtd\">\n"
+        "<target version=\"1.0\">\n<feature name=\"org.forwardcom.gp\">\n";
+    gdbTargetXml.push(head, (uint32_t)strlen(head));
+    for (int r = 0; r < 32; r++) {
+        snprintf(line, sizeof(line), "<reg name=\"r%i\" bitsize=\"64\" type=\"%s\" regnum=\"%i\"/>\n",
+            r, r == 31 ? "data_ptr" : "int64", r);
+        gdbTargetXml.push(line, (uint32_t)strlen(line));
+    }
+    snprintf(line, sizeof(line), "<reg name=\"ip\" bitsize=\"64\" type=\"code_ptr\" regnum=\"%i\"/>\n"
+        "</feature>\n<feature name=\"org.forwardcom.vector\">\n", gdb_reg_ip);
+    gdbTargetXml.push(line, (uint32_t)strlen(line));
+    snprintf(line, sizeof(line), "<vector id=\"v8\" type=\"uint8\" count=\"%u\"/>\n"
+        "<vector id=\"v32\" type=\"int32\" count=\"%u\"/>\n<vector id=\"v64\" type=\"int64\" count=\"%u\"/>\n"
+        "<vector id=\"vf\" type=\"ieee_single\" count=\"%u\"/>\n<vector id=\"vd\" type=\"ieee_double\" count=\"%u\"/>\n",
+        maxVectorLength, maxVectorLength / 4, maxVectorLength / 8, maxVectorLength / 4, maxVectorLength / 8);
+    gdbTargetXml.push(line, (uint32_t)strlen(line));
+    const char * vec = "<union id=\"vec\">\n<field name=\"b\" type=\"v8\"/>\n<field name=\"i\" type=\"v32\"/>\n"
+        "<field name=\"q\" type=\"v64\"/>\n<field name=\"f\" type=\"vf\"/>\n<field name=\"d\" type=\"vd\"/>\n</union>\n";
+    gdbTargetXml.push(vec, (uint32_t)strlen(vec));
+    for (uint32_t v = 0; v < 32; v++) {
+        snprintf(line, sizeof(line), "<reg name=\"v%u\" bitsize=\"%u\" type=\"vec\" regnum=\"%u\"/>\n",
+            v, maxVectorLength * 8, gdb_reg_v0 + v);
+        gdbTargetXml.push(line, (uint32_t)strlen(line));
+    }
+    const char * tail = "</feature>\n</target>\n";
+    gdbTargetXml.push(tail, (uint32_t)strlen(tail));
+}
+
+// wait for connection from debugger. return false if failed
+static bool gdbConnect(uint32_t port) {
+#if defined(_WIN32) || defined(__WINDOWS__)
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) return false;
+#endif
+    gdbSocket_t listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenSocket == GDB_INVALID_SOCKET) return false;
+    int yes = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes));
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // accept only local connections
+    address.sin_port = htons((uint16_t)port);
+    if (bind(listenSocket, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listenSocket, 1) != 0) {
+        gdbCloseSocket(listenSocket);
+        return false;
+    }
+    printf("\nWaiting for GDB connection on port %u\n", port);
+    fflush(stdout);
+    gdbSocket = accept(listenSocket, 0, 0);
+    gdbCloseSocket(listenSocket);
+    if (gdbSocket == GDB_INVALID_SOCKET) return false;
+    setsockopt(gdbSocket, IPPROTO_TCP, TCP_NODELAY, (const char*)&yes, sizeof(yes)); // packets are small
+    return true;
+}
+
+// close connection to debugger
+static void gdbDisconnect() {
+    if (gdbSocket != GDB_INVALID_SOCKET) gdbCloseSocket(gdbSocket);
+    gdbSocket = GDB_INVALID_SOCKET;
+#if defined(_WIN32) || defined(__WINDOWS__)
+    WSACleanup();
+#endif
+}
+
+// GDB signal number for interrupt that terminated execution
+static uint32_t gdbSignalNumber(uint32_t interrupt) {
+    switch (interrupt) {
+    case INT_UNKNOWN_INST: case INT_WRONG_PARAMETERS:
+        return 4;                                // SIGILL
+    case INT_MISALIGNED_MEM: case INT_MISALIGNED_JUMP:
+        return 7;                                // SIGBUS
+    case INT_ACCESS_READ: case INT_ACCESS_WRITE: case INT_ACCESS_EXE: case INT_CALL_STACK: case INT_ARRAY_BOUNDS:
+        return 11;                               // SIGSEGV
+    }
+    return 5;                                    // SIGTRAP
+}
+
+// run under control of GDB
+void CThread::gdbRun() {
+    if (!gdbConnect(cmd.gdbPort)) {
+        err.submit(ERR_GDB_CONNECT, cmd.gdbPort);
+        return;
+    }
+    gdbMakeTargetXml(MaxVectorLength);
+    listStart();                                 // start writing debug output list
+    running = 1;  terminate = false;
+    gdbSignal = 5;                               // stop at entry point
+    uint32_t countdown = gdb_poll_interval;
+    while (running) {
+        if (gdbSignal || terminate) {
+            // stopped. let debugger inspect the state
+            if (!gdbStopped()) break;            // detached or killed
+            if (terminate) break;
+        }
+        // execute one instruction as in run()
+        if (!(emulator->hleList.numEntries() && hleCall())) {
+            fetch();                             // fetch next instruction
+            if (terminate || gdbSignal) continue;// breakpoint stops before instruction is executed
+            decode();                            // decode instruction
+            if (terminate) continue;
+            execute();                           // execute instruction
+        }
+        gdbIgnoreAddress = ~uint64_t(0);
+        if (gdbStepping) gdbSignal = 5;          // stop after single step
+        // check for interrupt from debugger
+        if (--countdown == 0) {
+            countdown = gdb_poll_interval;
+            if (gdbSocket != GDB_INVALID_SOCKET && gdbGetChar(false) == 3) gdbSignal = 2; // SIGINT
+        }
+    }
+    gdbDisconnect();
+    // write debug output
+    if (listFileName) {
+        listOut.newLine();
+        listOut.tabulate(emulator->disassembler.asmTab0);
+        listOut.putDecimal(uint32_t(perfCounters[perf_instructions])); // Write number of instructions executed
+        listOut.put(" instructions executed.");
+        listOut.newLine();
+        listOut.write(cmd.getFilename(listFileName));
+    }
+}
+
+// report stop to GDB and process commands until continue or step.
+// return false if debugger detached or killed the program
+bool CThread::gdbStopped() {
+    char text[64];
+    if (gdbSocket == GDB_INVALID_SOCKET) {       // detached. continue without debugger
+        gdbSignal = 0;  return !terminate;
+    }
+    // stop reply. the initial stop at the entry point is reported only when the debugger asks
+    gdbReply.setDataSize(0);
+    if (terminate && terminateInterrupt == 0) {  // program exit
+        snprintf(text, sizeof(text), "W%02x", cmd.mainReturnValue & 0xFF);
+        gdbSend(text);
+        return false;
+    }
+    uint32_t signal = terminate ? gdbSignalNumber(terminateInterrupt) : gdbSignal;
+    gdbLastSignal = signal;
+    if (gdbWatchType && gdbSignal == 5) {
+        const char * kind = gdbWatchType == debug_watch_write ? "watch" : gdbWatchType == debug_watch_read ? "rwatch" : "awatch";
+        snprintf(text, sizeof(text), "T%02x%s:%llx;", signal, kind, (unsigned long long)gdbWatchAddress);
+    }
+    else snprintf(text, sizeof(text), "S%02x", signal);
+    gdbPutText(text);
+    gdbWatchType = 0;
+    if (gdbResumed && !gdbSendReply()) return false;
+    gdbResumed = false;
+    // process commands
+    while (true) {
+        int p = gdbGetPacket();
+        if (p == 0) return false;                // connection closed
+        if (p == 3) continue;                    // interrupt while stopped. ignore
+        bool resume = false;
+        if (!gdbCommand(resume)) return false;
+        if (resume) {
+            if (terminate) {                     // cannot continue after fatal error
+                snprintf(text, sizeof(text), "X%02x", signal);
+                gdbSend(text);
+                return false;
+            }
+            gdbSignal = 0;
+            return true;
+        }
+    }
+}
+
+// read or write register in hexadecimal. return size in bytes, or 0 if invalid register number
+uint64_t CThread::gdbRegister(uint32_t reg, char * hex, bool write) {
+    uint8_t * p;                                 // pointer to register value
+    uint32_t size = 8;
+    if (reg < 32) p = (uint8_t*)&registers[reg];
+    else if (reg == gdb_reg_ip) p = (uint8_t*)&ip;
+    else if (reg < gdb_num_regs) {
+        p = (uint8_t*)vectors.buf() + (reg - gdb_reg_v0) * MaxVectorLength;
+        size = MaxVectorLength;
+    }
+    else return 0;
+    if (write) {
+        for (uint32_t i = 0; i < size; i++) {
+            int h1 = gdbHexValue(hex[i*2]);
+            int h2 = h1 < 0 ? -1 : gdbHexValue(hex[i*2+1]);
+            if (h2 < 0) return 0;
+            p[i] = uint8_t(h1 << 4 | h2);
+        }
+        if (reg >= gdb_reg_v0) {                 // written vector has full length
+            vectorLength[reg - gdb_reg_v0] = MaxVectorLength;
+        }
+    }
+    else gdbPutHexBytes(p, size);
+    return size;
+}
+
+// update memory map after breakpoints changed
+void CThread::gdbUpdateMap() {
+    emulator->debugUpdateMap();
+    memoryMap.copy(emulator->memoryMap);
+    mapIndex1 = mapIndex2 = mapIndex3 = 0;
+}
+
+// process one command from GDB in gdbPacket.
+// resume is set to true for continue and step commands.
+// return false if the program should stop running
+bool CThread::gdbCommand(bool & resume) {
+    char * packet = (char*)gdbPacket.buf();
+    const char * p = packet + 1;
+    char text[64];
+    gdbReply.setDataSize(0);
+    switch (packet[0]) {
+    case '?':                                    // reason for stopping
+        snprintf(text, sizeof(text), "S%02x", gdbLastSignal);
+        gdbPutText(text);
+        break;
+    case 'g':                                    // read all registers
+        for (uint32_t r = 0; r < gdb_num_regs; r++) gdbRegister(r, 0, false);
+        break;
+    case 'G': {                                  // write all registers
+        char * hex = packet + 1;
+        for (uint32_t r = 0; r < gdb_num_regs; r++) {
+            if (strlen(hex) < 16) break;
+            hex += gdbRegister(r, hex, true) * 2;
+        }
+        gdbPutText("OK");
+        break;}
+    case 'p': {                                  // read register
+        uint32_t reg = (uint32_t)gdbReadHex(p);
+        if (gdbRegister(reg, 0, false) == 0) gdbPutText("E01");
+        break;}
+    case 'P': {                                  // write register
+        uint32_t reg = (uint32_t)gdbReadHex(p);
+        if (*p == '=' && gdbRegister(reg, (char*)p + 1, true)) gdbPutText("OK");
+        else gdbPutText("E01");
+        break;}
+    case 'm': case 'M': {                        // read or write memory
+        uint64_t address = gdbReadHex(p);
+        uint64_t size = *p == ',' ? gdbReadHex(++p) : 0;
+        if (address >= emulator->memsize || size > emulator->memsize - address || size > 0x10000) {
+            gdbPutText("E01");
+        }
+        else if (packet[0] == 'm') {
+            gdbPutHexBytes(memory + address, (uint32_t)size);
+        }
+        else if (*p == ':' && strlen(p + 1) >= size * 2) {
+            p++;
+            uint64_t i;
+            for (i = 0; i < size * 2; i++) {     // check all digits before writing anything
+                if (gdbHexValue(p[i]) < 0) break;
+            }
+            if (i < size * 2) {
+                gdbPutText("E01");  break;
+            }
+            for (i = 0; i < size; i++, p += 2) {
+                memory[address + i] = int8_t(gdbHexValue(p[0]) << 4 | gdbHexValue(p[1]));
+            }
+            gdbPutText("OK");
+        }
+        else gdbPutText("E01");
+        break;}
+    case 'c': case 's':                          // continue or step
+        if (*p) ip = gdbReadHex(p);              // resume at new address
+        gdbIgnoreAddress = ip;                   // don't stop at breakpoint here
+        gdbStepping = packet[0] == 's';          // stop after one instruction
+        gdbResumed = resume = true;
+        return true;
+    case 'Z': case 'z': {                        // insert or remove breakpoint or watchpoint
+        uint32_t type = (uint32_t)gdbReadHex(p);
+        uint64_t address = *p == ',' ? gdbReadHex(++p) : 0;
+        uint64_t size = *p == ',' ? gdbReadHex(++p) : 0;
+        static const uint32_t debugTypes[5] = {debug_break, debug_break, debug_watch_write, debug_watch_read, debug_watch_read | debug_watch_write};
+        if (type > 4) break;                     // unsupported type. empty reply
+        if (type < 2) size = 4;                  // breakpoint kind is instruction size
+        if (address >= emulator->memsize || size == 0 || size > emulator->memsize - address) {
+            gdbPutText("E01");  break;
+        }
+        CDynamicArray<SDebugPoint> & points = emulator->debugPoints;
+        uint32_t i;
+        for (i = 0; i < points.numEntries(); i++) {  // find existing entry
+            if (points[i].action == debug_action_gdb && points[i].address == address && points[i].type == debugTypes[type]
+            && points[i].end == address + size) break;
+        }
+        if (packet[0] == 'Z' && i == points.numEntries()) {
+            SDebugPoint point;
+            zeroAllMembers(point);
+            point.address = address;
+            point.end = address + size;
+            point.type = debugTypes[type];
+            point.reg = debug_no_condition;
+            point.action = debug_action_gdb;
+            point.name = emulator->debugNames.pushString("gdb");
+            points.push(point);
+            gdbUpdateMap();
+        }
+        else if (packet[0] == 'z' && i < points.numEntries()) {
+            SDebugPoint last = points.pop();     // move last entry into the vacant place
+            if (i < points.numEntries()) points[i] = last;
+            gdbUpdateMap();
+        }
+        gdbPutText("OK");
+        break;}
+    case 'q':                                    // general query
+        if (strncmp(packet, "qSupported", 10) == 0) {
+            uint32_t packetSize = (32 * 8 + 8 + 32 * MaxVectorLength) * 2 + 64; // enough for 'g' reply
+            snprintf(text, sizeof(text), "PacketSize=%x;qXfer:features:read+", packetSize);
+            gdbPutText(text);
+        }
+        else if (strncmp(packet, "qXfer:features:read:target.xml:", 31) == 0) {
+            p = packet + 31;
+            uint64_t offset = gdbReadHex(p);
+            uint64_t size = *p == ',' ? gdbReadHex(++p) : 0;
+            uint64_t total = gdbTargetXml.dataSize();
+            if (offset >= total) gdbPutText("l");
+            else {
+                if (size > total - offset) size = total - offset;
+                gdbReply.push(offset + size < total ? "m" : "l", 1);
+                gdbReply.push(gdbTargetXml.buf() + offset, (uint32_t)size);
+            }
+        }
+        else if (strncmp(packet, "qAttached", 9) == 0) gdbPutText("1");
+        else if (strcmp(packet, "qC") == 0) gdbPutText("QC1");
+        else if (strcmp(packet, "qfThreadInfo") == 0) gdbPutText("m1");
+        else if (strcmp(packet, "qsThreadInfo") == 0) gdbPutText("l");
+        else if (strncmp(packet, "qSymbol", 7) == 0) gdbPutText("OK");
+        break;                                   // empty reply to unsupported queries
+    case 'H':                                    // set thread. only one thread
+    case 'T':                                    // thread alive
+        gdbPutText("OK");
+        break;
+    case 'D':                                    // detach. continue without debugger
+        gdbSend("OK");
+        gdbDisconnect();
+        for (uint32_t i = emulator->debugPoints.numEntries(); i > 0; i--) {
+            if (emulator->debugPoints[i-1].action == debug_action_gdb) {
+                SDebugPoint last = emulator->debugPoints.pop();
+                if (i - 1 < emulator->debugPoints.numEntries()) emulator->debugPoints[i-1] = last;
+            }
+        }
+        gdbUpdateMap();
+        gdbStepping = false;
+        resume = true;
+        return true;
+    case 'k':                                    // kill
+        terminate = true;
+        return false;
+    }
+    // unsupported commands get an empty reply
+    return gdbSendReply();
+}
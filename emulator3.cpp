@@ -35,6 +35,14 @@
 // Note: these functions are only available in x86 systems with SSE2 or x64 enabled
 //////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#if MCSCR_AVAILABLE
+// Copy of the control bits of MXCSR (rounding mode and subnormal handling).
+// Writing MXCSR is slow because it serializes the execution pipeline, so it is
+// written only when the control bits actually change. The exception flags are
+// not included because they are set by the hardware
+static uint32_t mxcsrControl = _mm_getcsr() & 0xFFC0;
+#endif
+
 // Error message if MXCSR not available
 void errorFpControlMissing() {
     static int repeated = 0;
@@ -50,9 +58,10 @@ void setRoundingMode(uint8_t r) {
     // Rounding mode 4: "odd if not exact" is not supported on x86-64 platform.
     // Implement it by rounding up and down. If the two values are different then take the odd one.
     if (r == 4) r = 1;
-    uint32_t e = _mm_getcsr();
-    e = (e & 0x9FFF) | (r & 3) << 13;
-    _mm_setcsr(e);
+    uint32_t c = (mxcsrControl & 0x9FFF) | (r & 3) << 13;
+    if (c == mxcsrControl) return;               // no change
+    mxcsrControl = c;
+    _mm_setcsr((_mm_getcsr() & 0x3F) | c);       // keep exception flags
 #else
     errorFpControlMissing();
 #endif
@@ -61,8 +70,9 @@ void setRoundingMode(uint8_t r) {
 void clearExceptionFlags() {
     // clear exception flags before detecting exceptions
 #if MCSCR_AVAILABLE
+    // MXCSR is written only if there are exception flags to clear
     uint32_t e = _mm_getcsr();
-    _mm_setcsr(e & 0xFFC0);
+    if (e & 0x3F) _mm_setcsr(e & 0xFFC0);
 #else
     errorFpControlMissing();
 #endif
@@ -87,13 +97,10 @@ uint32_t getExceptionFlags() {
 void enableSubnormals(uint32_t e) {
     // enable or disable subnormal numbers
 #if MCSCR_AVAILABLE
-    uint32_t x = _mm_getcsr();
-    if (e != 0) {    
-        _mm_setcsr(x & ~0x8040);
-    }
-    else {
-        _mm_setcsr(x | 0x8040);
-    }
+    uint32_t c = e != 0 ? mxcsrControl & ~0x8040 : mxcsrControl | 0x8040;
+    if (c == mxcsrControl) return;               // no change
+    mxcsrControl = c;
+    _mm_setcsr((_mm_getcsr() & 0x3F) | c);       // keep exception flags
 #else
     errorFpControlMissing();
 #endif
@@ -265,6 +265,7 @@ static uint64_t read_perf(CThread * t) {
             t->perfCounters[perf_cpu_clock_cycles] = 0;
         }
         if (par2 & 2) {
+            t->ninstructions += t->perfCounters[perf_instructions]; // remember total count for emulator report
             t->perfCounters[perf_instructions] = 0;
             t->perfCounters[perf_2size_instructions] = 0;
             t->perfCounters[perf_3size_instructions] = 0;
@@ -291,6 +292,7 @@ static uint64_t read_perf(CThread * t) {
         switch (par2) {
         case 0:
             result = t->perfCounters[perf_instructions];
+            t->ninstructions += result;          // remember total count for emulator report
             t->perfCounters[perf_instructions] = 0;
             t->perfCounters[perf_2size_instructions] = 0;
             t->perfCounters[perf_3size_instructions] = 0;
@@ -12,6 +12,13 @@
 
 #include "stdafx.h"
 
+#if defined (_WIN32) || defined (__WINDOWS__)
+#define isatty _isatty                           // io.h is included by stdafx.h
+#define fileno _fileno
+#else
+#include <unistd.h>                              // isatty
+#endif
+
 // Data encoding names
 
 // Interrupt names
@@ -58,6 +65,8 @@ SIntTxt systemFunctionNames[] = {
     {SYSF_FTELL,             "ftell"},      // get file position 
     {SYSF_FSEEK,             "fseek"},      // set file position 
     {SYSF_FERROR,            "ferror"},     // get file error    
+    {SYSF_FREADV,            "freadv"},     // read from file into multiple buffers
+    {SYSF_FWRITEV,           "fwritev"},    // write multiple buffers to file
     {SYSF_GETCHAR,           "getchar"},    // read character from stdin 
     {SYSF_FGETC,             "fgetc"},      // read character from file 
     {SYSF_FGETS,             "fgets"},      // read string from file 
@@ -65,6 +74,11 @@ SIntTxt systemFunctionNames[] = {
     {SYSF_FSCANF,            "fscanf"},     // read formatted input from file 
     {SYSF_SSCANF,            "sscanf"},     // read formatted input from string buffer 
     {SYSF_REMOVE,            "remove"},     // delete file 
+
+// memory allocation functions
+    {SYSF_MALLOC,            "malloc"},     // allocate memory on heap
+    {SYSF_FREE,              "free"},       // free memory on heap
+    {SYSF_REALLOC,           "realloc"},    // resize memory block on heap
 };
 
 // number of entries in list
@@ -74,10 +88,12 @@ const int numSystemFunctionNames = sizeof(systemFunctionNames) / sizeof(SIntTxt)
 // interrupt or trap
 // To trace a runtime error, set a breakpoint here
 void CThread::interrupt(uint32_t n) {
+    if (recording) replayInterrupt = n;     // interrupt during recorded system function
     // check if error is disabled
     uint32_t capabbit = 0;                  // bit in capabilities register
     switch (n) {
     case INT_BREAKPOINT:                    // debug breakpoint
+        if (cmd.gdbPort) gdbSignal = 5;     // SIGTRAP. stop in debugger
         listOut.tabulate(emulator->disassembler.asmTab0);
         listOut.put("breakpoint");
         listOut.newLine();
@@ -124,8 +140,10 @@ void CThread::interrupt(uint32_t n) {
 
     if (!(capabilyReg[disable_errors_capability_register] & capabbit)) {
         terminate = true;                   // stop execution unless error is disabled
+        terminateInterrupt = n;
     }
-    if (listFileName && cmd.maxLines != 0) {   // write interrupt to debug output
+    bool flushed = listFileName && listFlushRing(); // write last instructions before interrupt
+    if (listFileName && (cmd.maxLines != 0 || flushed)) {   // write interrupt to debug output
         listOut.tabulate(emulator->disassembler.asmTab0);
         const char * iname = Lookup(interruptNames, n);
         listOut.put(iname);
@@ -158,48 +176,247 @@ uint64_t CThread::checkSysMemAccess(uint64_t address, uint64_t size, uint8_t rd,
         if (address < base) return 0;
         if (address + size > base + bsize) size = base + bsize - address;
     }
-    // check application's memory map
+    // check application's memory map.
+    // use the original permissions if watchpoints have removed permissions from the memory map
+    CDynamicArray<SMemoryMap> & map = emulator->debugPoints.numEntries() ? emulator->debugMap : memoryMap;
     uint32_t index = mapIndex3;
+    if (index + 1 >= map.numEntries()) index = 0;
     // find index
-    while (address < memoryMap[index].startAddress) {
+    while (address < map[index].startAddress) {
         if (index > 0) index--;
         else return 0;
     }
-    while (address >= memoryMap[index+1].startAddress) {
-        if (index+2 < memoryMap.numEntries()) index++;
+    while (address >= map[index+1].startAddress) {
+        if (index+2 < map.numEntries()) index++;
         else return 0;
     }
     // check read/write permission
-    if ((memoryMap[index].access_addend & mode) != mode) return 0;
+    if ((map[index].access_addend & mode) != mode) return 0;
 
     // check if multiple map entries covered
     uint32_t index2 = index;
-    while (address + size >= memoryMap[index2+1].startAddress
-        && index2+2 < memoryMap.numEntries() 
-        && (memoryMap[index2+1].access_addend & mode) == mode) {
+    while (address + size >= map[index2+1].startAddress
+        && index2+2 < map.numEntries() 
+        && (map[index2+1].access_addend & mode) == mode) {
             index2++;
         }
-    uint64_t size2 = memoryMap[index2+1].startAddress - address;  // maximum possible size
-    if (size < size2) size = size2;
+    uint64_t size2 = map[index2+1].startAddress - address;  // maximum possible size
+    if (size > size2) size = size2;
     return size;
 }
 
-// emulate fprintf with ForwardCom argument list
-int CThread::fprintfEmulated(FILE * stream, const char * format, uint64_t * argumentList) {
-    // a ForwardCom argument list is compatible with a va_list in 64-bit windows but not in Linux
-    static CMemoryBuffer fstringbuf;             // buffer containing format string
-    fstringbuf.setSize(0);                       // discard any previously stored string
-    fstringbuf.pushString(format);               // copy format string
-    // split the format string into substrings with a single format specifier in each
-    uint32_t arg = 0;                            // argument index
-    int returnValue;                             // return value;
-    int returnSum = 0;                           // sum of return values;
-    char * startp;                               // start of current substring in format string
-    char * percentp1;                            // percent sign in current substring
-    char * percentp2;                            // next percent sign starting next substring
-    char * trailing = 0;                         // any text following format specifier
-    startp = fstringbuf.getString(0);            // start of string buffer
-    percentp1 = startp;                          // search for first % sign
+// set up host buffers for standard output
+void CEmulator::ioSetup() {
+    // Character-at-a-time output from the emulated program goes through a large buffer
+    // when stdout is redirected to a file or pipe. Terminal output remains line buffered
+    // so that prompts are visible before input is read
+    if (!isatty(fileno(stdout))) {
+        setvbuf(stdout, 0, _IOFBF, sys_stdout_buffer_size);
+    }
+}
+
+// system functions with results that depend on the environment.
+// These are logged with the -record option and fed back with the -replay option
+static bool isNondeterministic(uint32_t funcid) {
+    switch (funcid) {
+    case SYSF_TIME:   case SYSF_FOPEN:  case SYSF_FCLOSE: case SYSF_FREAD:  case SYSF_FWRITE:
+    case SYSF_FREADV: case SYSF_FWRITEV:case SYSF_FFLUSH: case SYSF_FEOF:   case SYSF_FTELL:
+    case SYSF_FSEEK:  case SYSF_FERROR: case SYSF_FPRINTF:case SYSF_GETCHAR:case SYSF_FGETC:
+    case SYSF_FGETS:  case SYSF_GETS_S: case SYSF_REMOVE:
+        return true;
+    }
+    return false;
+}
+
+// output functions that write to stdout or stderr. These are performed normally
+// during replay, and they are not logged
+static bool isStandardOutput(uint32_t funcid, uint64_t const * registers) {
+    FILE * file;
+    switch (funcid) {
+    case SYSF_FWRITE:
+        file = (FILE *)(size_t)registers[3];  break;
+    case SYSF_FWRITEV:
+        file = (FILE *)(size_t)registers[2];  break;
+    case SYSF_FPRINTF: case SYSF_FFLUSH:
+        file = (FILE *)(size_t)registers[0];  break;
+    default:
+        return false;
+    }
+    return file == stdout || file == stderr;
+}
+
+// prepare recording or replay of system function results
+void CEmulator::replaySetup() {
+    if (!cmd.recordFile && !cmd.replayFile) return;
+    // the log is valid only for the same executable file
+    SReplayHeader header;
+    memcpy(header.signature, "FWCREPLY", 8);
+    header.fileSize = dataSize();
+    header.fileHash = hashBytes(buf(), dataSize());
+    if (cmd.recordFile) {
+        replayLog.push(&header, sizeof(header));
+        return;
+    }
+    const char * filename = cmd.getFilename(cmd.replayFile);
+    replayLog.read(filename);
+    if (err.number()) return;
+    if (replayLog.dataSize() < sizeof(header) || memcmp(replayLog.buf(), &header, sizeof(header)) != 0) {
+        err.submit(ERR_REPLAY_FILE, filename);
+        return;
+    }
+    replayPos = sizeof(header);
+}
+
+// save recorded system function results
+void CEmulator::replayFinish() {
+    if (cmd.recordFile) replayLog.write(cmd.getFilename(cmd.recordFile));
+}
+
+// log the result of a system function and the memory it has written
+void CThread::recordSystemCall(uint32_t funcid) {
+    CFileBuffer & log = emulator->replayLog;
+    SReplayRecord rec;
+    rec.function = funcid;
+    rec.numRanges = replayRanges.numEntries();
+    rec.interrupt = replayInterrupt;
+    rec.unused = 0;
+    rec.result = registers[0];
+    log.push(&rec, sizeof(rec));
+    for (uint32_t i = 0; i < replayRanges.numEntries(); i++) {
+        SIOVector & range = replayRanges[i];
+        if (range.size > 0x7FFFFFFF - log.dataSize()) {
+            // the log is limited to the size of a memory buffer
+            const char * name = lookupText(systemFunctionNames, numSystemFunctionNames, funcid);
+            err.submit(ERR_REPLAY_TOO_BIG, name);
+            terminate = true;
+            break;
+        }
+        log.push(&range, sizeof(range));
+        log.push(memory + range.address, (uint32_t)range.size);
+        log.align(8);
+    }
+    replayRanges.setNum(0);
+    replayInterrupt = 0;
+}
+
+// get the result of a system function from the log instead of calling it
+void CThread::replaySystemCall(uint32_t funcid) {
+    CFileBuffer & log = emulator->replayLog;
+    uint32_t & pos = emulator->replayPos;
+    SReplayRecord rec;
+    bool ok = pos + sizeof(SReplayRecord) <= log.dataSize();
+    if (ok) {
+        rec = log.get<SReplayRecord>(pos);
+        ok = rec.function == funcid;
+        pos += sizeof(SReplayRecord);
+    }
+    for (uint32_t i = 0; ok && i < rec.numRanges; i++) {
+        // copy recorded data into emulated memory. access rights were checked when recording
+        ok = pos + sizeof(SIOVector) <= log.dataSize();
+        if (!ok) break;
+        SIOVector range = log.get<SIOVector>(pos);
+        pos += sizeof(SIOVector);
+        ok = range.size <= log.dataSize() - pos && range.address + range.size <= emulator->memsize;
+        if (!ok) break;
+        memcpy(memory + range.address, log.buf() + pos, (size_t)range.size);
+        pos += uint32_t((range.size + 7) & -8);
+    }
+    if (!ok) {
+        // the program has taken a different path than when recording
+        const char * name = lookupText(systemFunctionNames, numSystemFunctionNames, funcid);
+        err.submit(ERR_REPLAY_MISMATCH, name);
+        terminate = true;
+        return;
+    }
+    registers[0] = rec.result;
+    if (rec.interrupt) interrupt(rec.interrupt);  // repeat any interrupt generated by the function
+}
+
+// read or write multiple buffers in one system call
+uint64_t CThread::fileVectorIO(uint64_t iovAddress, uint64_t num, FILE * file, bool write, uint8_t rd, uint8_t rs) {
+    // iovAddress = address of an array of num SIOVector records in emulated memory
+    // return value is the total number of bytes transferred
+    uint64_t total = 0;                          // number of bytes transferred
+    uint64_t iovSize = num * sizeof(SIOVector);  // size of SIOVector array
+    if (num > 0xFFFFFFFF || checkSysMemAccess(iovAddress, iovSize, rd, rs, SHF_READ) < iovSize) {
+        interrupt(INT_ACCESS_READ);              // read access violation
+        return 0;
+    }
+    for (uint64_t i = 0; i < num; i++) {
+        SIOVector iov = ((SIOVector*)(memory + iovAddress))[i];
+        // one access check for each buffer. data are transferred directly between the host file and emulated memory
+        if (checkSysMemAccess(iov.address, iov.size, rd, rs, write ? SHF_READ : SHF_WRITE) < iov.size) {
+            interrupt(write ? INT_ACCESS_READ : INT_ACCESS_WRITE);
+            break;
+        }
+        size_t n;
+        if (write) n = fwrite(memory + iov.address, 1, (size_t)iov.size, file);
+        else {
+            n = fread(memory + iov.address, 1, (size_t)iov.size, file);
+            recordRange(iov.address, n);
+        }
+        total += n;
+        if (n < iov.size) break;                 // end of file or error
+    }
+    return total;
+}
+
+// parse a printf format string into a list of directives.
+// Formats are parsed only once and cached by address. A format in writeable
+// memory is compared with a saved copy to detect if it has been modified.
+// A modified format reuses its storage if it was the last one parsed, and the
+// whole cache is cleared if it grows too big, so that programs that build
+// formats in a buffer do not make the cache grow without limit
+uint32_t CThread::parseFormat(uint64_t format) {
+    // return value is index into emulator->formatCache
+    CEmulator & e = *emulator;
+    SFormatCache rec;
+    rec.address = format;
+    // search for previously parsed format
+    int32_t i = -1;
+    if (e.lastFormat < e.formatCache.numEntries() && e.formatCache[e.lastFormat].address == format) {
+        i = e.lastFormat;
+    }
+    else {
+        i = e.formatCache.findFirst(rec);
+    }
+    if (i >= 0) {
+        SFormatCache & old = e.formatCache[i];
+        if (!old.writeable || strcmp(e.formatStrings.getString(old.source), (const char*)memory + format) == 0) {
+            return e.lastFormat = i;             // found unchanged format
+        }
+        if (old.first + old.num == e.formatDirectives.numEntries()) {
+            // modified format was parsed last. discard its old directives and text
+            e.formatDirectives.setNum(old.first);
+            e.formatStrings.setSize(old.source);
+        }
+    }
+    if (e.formatStrings.dataSize() > sys_format_cache_size) {
+        // too many formats. start over
+        e.formatCache.setNum(0);
+        e.formatDirectives.setNum(0);
+        e.formatStrings.setSize(0);
+        i = -1;
+    }
+    // check if format is in writeable memory so that it may change.
+    // use the original permissions if watchpoints have removed permissions from the memory map
+    CDynamicArray<SMemoryMap> & map = emulator->debugPoints.numEntries() ? emulator->debugMap : memoryMap;
+    uint32_t index = mapIndex2;
+    if (index + 1 >= map.numEntries()) index = 0;
+    while (format < map[index].startAddress && index > 0) index--;
+    while (format >= map[index+1].startAddress && index+2 < map.numEntries()) index++;
+    rec.writeable = (map[index].access_addend & SHF_WRITE) != 0;
+    rec.source = 0;
+    if (rec.writeable) {                         // save a copy of the original format
+        rec.source = e.formatStrings.pushString((const char*)memory + format);
+    }
+    // split the format string into substrings with a single format specifier in each.
+    // each substring is stored with a terminating zero in formatStrings
+    rec.first = e.formatDirectives.numEntries();
+    rec.num = 0;
+    const char * startp = (const char *)memory + format; // start of current substring
+    const char * percentp1 = startp;             // percent sign in current substring
+    const char * percentp2;                      // next percent sign starting next substring
     while (true) {
         percentp1 = strchr(percentp1, '%');
         if (percentp1 && percentp1[1] == '%') percentp1 += 2; // skip "%%" which is not a format code
@@ -207,90 +424,127 @@ int CThread::fprintfEmulated(FILE * stream, const char * format, uint64_t * argu
     }
     // loop for substrings of format string containing only one format specifier each
     do {
-        char c = 0;                                      // format character
-        int asterisks = 0;
-        bool isString = false;
+        SFormatDirective dir;
+        zeroAllMembers(dir);
         if (percentp1) {
-            percentp2 = percentp1 + 1;               // search for next % sign
+            percentp2 = percentp1 + 1;           // search for next % sign
             while (true) {
                 percentp2 = strchr(percentp2, '%');
                 if (percentp2 && percentp2[1] == '%') percentp2 += 2; // skip "%%" which is not a format code
                 else break;
             }
-            if (percentp2) *percentp2 = 0;           // put temporary end of string at next % sign
-            // check if argument is a string, and count asterisks
+            // check argument type, and count asterisks
             int i = 1;
             while (true) {
-                c = percentp1[i++];                  // read character in format specifier
-                trailing = percentp1+i;              // point to next character
-                if (c == 0) break;                   // end of string
-                if (c == '*') asterisks++;           // count asterisks
-                c |= 0x20;                           // lower case
-                if (c == 's') isString = true;       // %s means string
-                if (c >= 'a' && c <= 'z') break;     // a letter terminates the format specifier
+                char c = percentp1[i++];         // read character in format specifier
+                dir.trailing = uint32_t(percentp1 + i - startp); // point to next character
+                if (c == 0 || percentp1 + i - 1 == percentp2) break;  // end of substring
+                if (c == '*') dir.asterisks++;   // count asterisks
+                c |= 0x20;                       // lower case
+                if (c == 's') dir.type = 1;      // %s means string
+                if (c == 'a' || c == 'e' || c == 'f' || c == 'g') dir.type = 2; // floating point
+                if (c >= 'a' && c <= 'z') break; // a letter terminates the format specifier
             }
         }
         else {
             percentp2 = 0;
         }
-        uint64_t argument = argumentList[arg];   // The argument list can contain any type of argument with size up to 64 bits
+        uint32_t len = percentp2 ? uint32_t(percentp2 - startp) : (uint32_t)strlen(startp);
+        dir.text = e.formatStrings.push(startp, len);
+        e.formatStrings.push("", 1);             // terminating zero
+        if (dir.trailing > len) dir.trailing = len;
+        e.formatDirectives.push(dir);
+        rec.num++;
+        startp = percentp1 = percentp2;
+    }
+    while (startp);                              // loop to next substring
+
+    if (i >= 0) {                                // replace modified format
+        e.formatCache[i] = rec;
+        return e.lastFormat = i;
+    }
+    return e.lastFormat = e.formatCache.addUnique(rec);
+}
+
+// emulate sprintf with ForwardCom argument list. The output is written to printBuffer
+int CThread::formatEmulated(uint64_t format, uint64_t argumentList) {
+    // a ForwardCom argument list is compatible with a va_list in 64-bit windows but not in Linux.
+    // return value is the number of characters written to printBuffer, or negative if error
+    uint64_t flen = checkSysMemAccess(format, uint64_t(-1), 31, 31, SHF_READ);
+    if (flen == 0 || memchr(memory + format, 0, (size_t)flen) == 0) {
+        interrupt(INT_ACCESS_READ);              // format string not in readable memory
+        return -1;
+    }
+    CEmulator & e = *emulator;
+    SFormatCache const & cache = e.formatCache[parseFormat(format)];
+    uint64_t * args = (uint64_t*)(memory + argumentList);
+    uint32_t arg = 0;                            // argument index
+    uint32_t pos = 0;                            // position in printBuffer
+    if (printBuffer.bufferSize() < 256) printBuffer.setSize(256);
+    for (uint32_t d = 0; d < cache.num; d++) {
+        SFormatDirective const & dir = e.formatDirectives[cache.first + d];
+        const char * text = e.formatStrings.getString(dir.text);
+        uint64_t argument = args[arg];           // The argument list can contain any type of argument with size up to 64 bits
         union {
             uint64_t a;
             double d;
         } uu;
-        if (isString) argument += (uint64_t)memory; // translate string address
-        // Print current argument with format substring.
-        if (asterisks) { // asterisks indicate extra arguments
-            if (c == 'a' || c == 'e' || c == 'f' || c == 'g') {
-                // floating point argument
-                if (asterisks == 1) {
-                    uu.a = argumentList[arg+1];
-                    returnValue = fprintf(stream, startp, argument, uu.d, argumentList[arg+2]);
+        if (dir.type == 1) argument += (uint64_t)memory; // translate string address
+        int n;                                   // number of characters written
+        // repeat if printBuffer is too small
+        while (true) {
+            char * dest = (char*)printBuffer.buf() + pos;
+            size_t space = printBuffer.bufferSize() - pos;
+            if (dir.asterisks) { // asterisks indicate extra arguments
+                if (dir.type == 2) {             // floating point argument
+                    if (dir.asterisks == 1) {
+                        uu.a = args[arg+1];
+                        n = snprintf(dest, space, text, argument, uu.d, args[arg+2]);
+                    }
+                    else { // asterisks = 2
+                        uu.a = args[arg+2];
+                        n = snprintf(dest, space, text, argument, args[arg+1], uu.d);
+                    }
                 }
-                else { // asterisks = 2
-                    uu.a = argumentList[arg+2];
-                    returnValue = fprintf(stream, startp, argument, argumentList[arg+1], uu.d);
+                else {                           // integer argument
+                    n = snprintf(dest, space, text, argument, args[arg+1], args[arg+2]);
                 }
             }
-            else { // integer argument
-                returnValue = fprintf(stream, startp, argument, argumentList[arg+1], argumentList[arg+2]);
+            else if (dir.type == 2 && isnan_d(argument)) {
+                // NaN. write diagnostic exception code and any text following the format specifier
+                uint32_t exceptionCode = uint32_t(argument >> 42) & 0x1FF;
+                n = snprintf(dest, space, "NaN(%s)%s", exceptionCodeName(exceptionCode), text + dir.trailing);
             }
-            arg += asterisks + 1;
-        }
-        else {
-            if (c == 'a' || c == 'e' || c == 'f' || c == 'g') {
-                // floating point argument
+            else if (dir.type == 2) {
                 uu.a = argument;
-                if (isnan_d(uu.a)) { // NaN. write diagnostic exception code
-                    uint32_t exceptionCode = uint32_t(uu.a >> 42) & 0x1FF;
-                    returnValue = fprintf(stream, "NaN(%s)", exceptionCodeName(exceptionCode));
-                    if (trailing != 0 && trailing < percentp2) {
-                        // there is text following the format specifier
-                        returnValue += fprintf(stream, trailing);
-                    }
-                }
-                else {
-                    returnValue = fprintf(stream, startp, uu.d);
-                }
+                n = snprintf(dest, space, text, uu.d);
             }
-            else {            
-                returnValue = fprintf(stream, startp, argument);
+            else {
+                n = snprintf(dest, space, text, argument);
             }
-            arg++;
+            if (n < 0) return n;                 // return error
+            if ((size_t)n < space) break;        // success
+            printBuffer.setSize(pos + n + 1);    // make printBuffer bigger and try again
         }
-        if (returnValue < 0) return returnValue; // return error
-        else returnSum += returnValue;           // sum of return values
-        if (percentp2) *percentp2 = '%';         // re-insert next % sign
-        startp = percentp1 = percentp2;
+        pos += n;
+        arg += dir.asterisks + 1;
     }
-    while (startp);                              // loop to next substring
-    return returnSum;                            // return total number of characters written
+    return (int)pos;                             // return total number of characters
+}
+
+// emulate fprintf with ForwardCom argument list
+int CThread::fprintfEmulated(FILE * stream, uint64_t format, uint64_t argumentList) {
+    int n = formatEmulated(format, argumentList);
+    if (n <= 0) return n;
+    // write the whole output in one operation
+    if (fwrite(printBuffer.buf(), 1, n, stream) < (size_t)n) return -1;
+    return n;
 }
 
 
 // entry for system calls
 void CThread::systemCall(uint32_t mod, uint32_t funcid, uint8_t rd, uint8_t rs) {
-    if (listFileName) {    
+    if (listFileName && cmd.maxLines != 0) {
         // debug listing
         listOut.tabulate(emulator->disassembler.asmTab0);
         listOut.put("system call: ");
@@ -310,6 +564,16 @@ void CThread::systemCall(uint32_t mod, uint32_t funcid, uint8_t rd, uint8_t rs)
     uint64_t temp;    // temporary
     uint64_t dsize;   // data size
     const char * str = 0;    // string
+    bool record = false;     // record result of system function
+    if (mod == SYSM_SYSTEM && (recording || replaying) && isNondeterministic(funcid)
+    && !isStandardOutput(funcid, registers)) {
+        if (replaying) {
+            replaySystemCall(funcid);
+            return;
+        }
+        record = true;
+        replayInterrupt = 0;
+    }
     if (mod == SYSM_SYSTEM) {// system function
         // dispatch by function id
         switch (funcid) {
@@ -321,7 +585,10 @@ void CThread::systemCall(uint32_t mod, uint32_t funcid, uint8_t rd, uint8_t rs)
             terminate = true;  break;
         case SYSF_TIME:      // time
             temp = time(0);
-            if (registers[0] && checkSysMemAccess(registers[0], 8, rd, rs, SHF_WRITE)) *(uint64_t*)(memory + registers[0]) = temp;
+            if (registers[0] && checkSysMemAccess(registers[0], 8, rd, rs, SHF_WRITE)) {
+                *(uint64_t*)(memory + registers[0]) = temp;
+                recordRange(registers[0], 8);
+            }
             registers[0] = temp;  break;
         case SYSF_PUTS:      // write string to stdout
             str = (const char*)memory + registers[0];
@@ -334,24 +601,34 @@ void CThread::systemCall(uint32_t mod, uint32_t funcid, uint8_t rd, uint8_t rs)
             putchar((char)registers[0]); 
             break;
         case SYSF_PRINTF:    // write formatted output to stdout
-            registers[0] = fprintfEmulated(stdout, (const char*)memory + registers[0], (uint64_t*)(memory + registers[1]));
+            registers[0] = fprintfEmulated(stdout, registers[0], registers[1]);
             break; 
         case SYSF_FPRINTF:   // write formatted output to file
-            registers[0] = fprintfEmulated((FILE *)(registers[0]), (const char*)memory + registers[1], (uint64_t*)(memory + registers[2]));
+            registers[0] = fprintfEmulated((FILE *)(registers[0]), registers[1], registers[2]);
             break;
-            /*
         case SYSF_SNPRINTF:   // write formatted output to string buffer 
-            // this works only in 64 bit windows
-            dsize = registers[1];  // size of data to read
+            dsize = registers[1];  // size of buffer
             if (checkSysMemAccess(registers[0], dsize, rd, rs, SHF_WRITE) < dsize) {
                 interrupt(INT_ACCESS_WRITE); // write access violation
-                ret = 0;
+                registers[0] = 0;
             }
-            else ret = snprintf((char*)memory + registers[0], registers[1], (const char*)memory + registers[2], (const char*)memory + registers[3]);
-            registers[0] = ret;
-            break;*/
+            else {
+                int ret = formatEmulated(registers[2], registers[3]);
+                if (ret >= 0 && dsize > 0) {
+                    // copy to buffer and truncate if too long
+                    uint64_t n = (uint64_t)ret < dsize ? (uint64_t)ret : dsize - 1;
+                    memcpy(memory + registers[0], printBuffer.buf(), (size_t)n);
+                    memory[registers[0] + n] = 0;
+                }
+                registers[0] = (uint64_t)(int64_t)ret;
+            }
+            break;
         case SYSF_FOPEN:     //  open file
             registers[0] = (uint64_t)fopen((const char*)memory + registers[0], (const char*)memory + registers[1]);
+            if (registers[0]) {
+                // large host buffer to reduce the number of host system calls
+                setvbuf((FILE *)registers[0], 0, _IOFBF, sys_file_buffer_size);
+            }
             break;
         case SYSF_FCLOSE:    // SYSF_FCLOSE
             registers[0] = (uint64_t)fclose((FILE*)registers[0]);
@@ -362,7 +639,11 @@ void CThread::systemCall(uint32_t mod, uint32_t funcid, uint8_t rd, uint8_t rs)
                 interrupt(INT_ACCESS_WRITE); // write access violation
                 registers[0] = 0;
             }
-            else registers[0] = (uint64_t)fread(memory + registers[0], (size_t)registers[1], (size_t)registers[2], (FILE *)(size_t)registers[3]);
+            else {
+                temp = registers[0];
+                registers[0] = (uint64_t)fread(memory + registers[0], (size_t)registers[1], (size_t)registers[2], (FILE *)(size_t)registers[3]);
+                recordRange(temp, registers[0] * registers[1]);
+            }
             break;
         case SYSF_FWRITE:    // write to file 
             dsize = registers[1] * registers[2];  // size of data to write
@@ -372,6 +653,12 @@ void CThread::systemCall(uint32_t mod, uint32_t funcid, uint8_t rd, uint8_t rs)
             }
             else registers[0] = (uint64_t)fwrite(memory + registers[0], (size_t)registers[1], (size_t)registers[2], (FILE *)(size_t)registers[3]);
             break;
+        case SYSF_FREADV:    // read from file into multiple buffers
+            registers[0] = fileVectorIO(registers[0], registers[1], (FILE *)registers[2], false, rd, rs);
+            break;
+        case SYSF_FWRITEV:   // write multiple buffers to file
+            registers[0] = fileVectorIO(registers[0], registers[1], (FILE *)registers[2], true, rd, rs);
+            break;
         case SYSF_FFLUSH:    // flush file 
             registers[0] = (uint64_t)fflush((FILE *)registers[0]);
             break;
@@ -400,7 +687,9 @@ void CThread::systemCall(uint32_t mod, uint32_t funcid, uint8_t rd, uint8_t rs)
                 registers[0] = 0;
             }
             else {
+                temp = registers[0];
                 registers[0] = (uint64_t)fgets((char *)(memory+registers[0]), (int)registers[1], (FILE *)registers[2]);
+                if (registers[0]) recordRange(temp, strlen((char *)(memory+temp)) + 1);
             }
             break;
         case SYSF_GETS_S:     // read string from stdin 
@@ -412,6 +701,7 @@ void CThread::systemCall(uint32_t mod, uint32_t funcid, uint8_t rd, uint8_t rs)
             else {
                 char * r = fgets((char *)(memory+registers[0]), (int)registers[1], stdin);
                 if (r == 0) registers[0] = 0;  // registers[0] unchanged if success
+                else recordRange(registers[0], strlen(r) + 1);
             }
             break;
             /*
@@ -439,6 +729,22 @@ void CThread::systemCall(uint32_t mod, uint32_t funcid, uint8_t rd, uint8_t rs)
         case SYSF_REMOVE:    // delete file 
             registers[0] = (uint64_t)remove((char *)(memory+registers[0]));
             break;
+        case SYSF_MALLOC:    // allocate memory on heap
+            emulator->heapCalls[0]++;
+            registers[0] = emulator->heapAlloc(registers[0]);
+            break;
+        case SYSF_FREE:      // free memory on heap
+            emulator->heapCalls[1]++;
+            if (!emulator->heapFree(registers[0])) interrupt(INT_ACCESS_WRITE); // not an allocated block
+            break;
+        case SYSF_REALLOC:   // resize memory block on heap
+            emulator->heapCalls[2]++;
+            if (!emulator->heapRealloc(registers[0], registers[1])) {
+                interrupt(INT_ACCESS_WRITE);     // not an allocated block
+                registers[0] = 0;
+            }
+            break;
         }
     }
+    if (record) recordSystemCall(funcid);
 }
@@ -0,0 +1,243 @@
+/****************************  emulator7.cpp  ********************************
+* Author:        Agner Fog
+* date created:  2026-10-18
+* Last modified: 2026-10-18
+* Version:       1.14
+* Project:       Binary tools for ForwardCom instruction set
+* Description:
+* Emulator: Native high-level emulation of library functions
+*
+* Frequently used library functions, such as memcpy and strlen, can be
+* recognized by their symbol names in the executable file and replaced by
+* native versions. This is enabled by the command line option -hle or
+* -hle=name1,name2,...
+* The native versions use the ForwardCom calling convention and check memory
+* access permissions with checkSysMemAccess in the same way as system functions.
+*
+* Copyright 2018-2026 GNU General Public License http://www.gnu.org/licenses
+*****************************************************************************/
+
+#include "stdafx.h"
+
+// Native versions of library functions.
+// Parameters are in r0, r1, r2 or v0 according to the ForwardCom calling convention.
+// The return value is true if successful, false if an interrupt has been generated.
+
+static bool hle_memcpy(CThread * t) {
+    // void * memcpy(void * dest, const void * src, size_t n)
+    uint64_t dest = t->registers[0], src = t->registers[1], n = t->registers[2];
+    if (t->checkSysMemAccess(src, n, 31, 31, SHF_READ) < n) {
+        t->interrupt(INT_ACCESS_READ);  return false;
+    }
+    if (t->checkSysMemAccess(dest, n, 31, 31, SHF_WRITE) < n) {
+        t->interrupt(INT_ACCESS_WRITE);  return false;
+    }
+    // use memmove in case the caller relies on overlapping copy going well
+    memmove(t->memory + dest, t->memory + src, (size_t)n);
+    return true;                                 // r0 = dest is unchanged
+}
+
+static bool hle_memset(CThread * t) {
+    // void * memset(void * dest, int c, size_t n)
+    uint64_t dest = t->registers[0], n = t->registers[2];
+    if (t->checkSysMemAccess(dest, n, 31, 31, SHF_WRITE) < n) {
+        t->interrupt(INT_ACCESS_WRITE);  return false;
+    }
+    memset(t->memory + dest, (uint8_t)t->registers[1], (size_t)n);
+    return true;                                 // r0 = dest is unchanged
+}
+
+static bool hle_memcmp(CThread * t) {
+    // int memcmp(const void * a, const void * b, size_t n)
+    uint64_t a = t->registers[0], b = t->registers[1], n = t->registers[2];
+    if (t->checkSysMemAccess(a, n, 31, 31, SHF_READ) < n || t->checkSysMemAccess(b, n, 31, 31, SHF_READ) < n) {
+        t->interrupt(INT_ACCESS_READ);  return false;
+    }
+    t->registers[0] = (uint64_t)(int64_t)memcmp(t->memory + a, t->memory + b, (size_t)n);
+    return true;
+}
+
+// find the length of a zero-terminated string in emulated memory.
+// returns -1 if the string is not terminated inside readable memory
+static int64_t hleStringLength(CThread * t, uint64_t address) {
+    uint64_t maxlen = t->checkSysMemAccess(address, uint64_t(-1), 31, 31, SHF_READ);
+    if (maxlen == 0) return -1;
+    const void * end = memchr(t->memory + address, 0, (size_t)maxlen);
+    if (end == 0) return -1;
+    return (const int8_t*)end - (t->memory + address);
+}
+
+static bool hle_strlen(CThread * t) {
+    // size_t strlen(const char * s)
+    int64_t len = hleStringLength(t, t->registers[0]);
+    if (len < 0) {
+        t->interrupt(INT_ACCESS_READ);  return false;
+    }
+    t->registers[0] = (uint64_t)len;
+    return true;
+}
+
+static bool hle_strcmp(CThread * t) {
+    // int strcmp(const char * a, const char * b)
+    int64_t lena = hleStringLength(t, t->registers[0]);
+    int64_t lenb = hleStringLength(t, t->registers[1]);
+    if (lena < 0 || lenb < 0) {
+        t->interrupt(INT_ACCESS_READ);  return false;
+    }
+    t->registers[0] = (uint64_t)(int64_t)strcmp((const char*)t->memory + t->registers[0], (const char*)t->memory + t->registers[1]);
+    return true;
+}
+
+static bool hle_strcpy(CThread * t) {
+    // char * strcpy(char * dest, const char * src)
+    uint64_t dest = t->registers[0];
+    int64_t len = hleStringLength(t, t->registers[1]);
+    if (len < 0) {
+        t->interrupt(INT_ACCESS_READ);  return false;
+    }
+    if (t->checkSysMemAccess(dest, len + 1, 31, 31, SHF_WRITE) < uint64_t(len + 1)) {
+        t->interrupt(INT_ACCESS_WRITE);  return false;
+    }
+    memmove(t->memory + dest, t->memory + t->registers[1], size_t(len + 1));
+    return true;                                 // r0 = dest is unchanged
+}
+
+static bool hle_sqrt(CThread * t) {
+    // double sqrt(double x). parameter and return value in v0
+    double x = t->vectors.get<double>(0);
+    t->vectors.get<double>(0) = sqrt(x);
+    t->vectorLength[0] = 8;
+    return true;
+}
+
+static bool hle_sqrtf(CThread * t) {
+    // float sqrtf(float x). parameter and return value in v0
+    float x = t->vectors.get<float>(0);
+    t->vectors.get<float>(0) = sqrtf(x);
+    t->vectorLength[0] = 4;
+    return true;
+}
+
+// Table of library functions that can be replaced by native versions
+struct SHleFunction {
+    const char * name;                           // symbol name without leading underscore
+    bool (*func)(CThread * t);                   // native version
+};
+
+static const SHleFunction hleFunctions[] = {
+    {"memcpy",  hle_memcpy},
+    {"memmove", hle_memcpy},
+    {"memset",  hle_memset},
+    {"memcmp",  hle_memcmp},
+    {"strlen",  hle_strlen},
+    {"strcmp",  hle_strcmp},
+    {"strcpy",  hle_strcpy},
+    {"sqrt",    hle_sqrt},
+    {"sqrtf",   hle_sqrtf},
+};
+
+const int numHleFunctions = TableSize(hleFunctions);
+
+// check if function number f is in the list of enabled functions from the command line
+static bool hleEnabled(const char * list, uint32_t f) {
+    if (strcmp(list, "all") == 0) return true;
+    uint32_t len = (uint32_t)strlen(hleFunctions[f].name);
+    const char * p = list;
+    while (*p) {
+        const char * e = strchr(p, ',');         // find end of name in list
+        uint32_t n = e ? uint32_t(e - p) : (uint32_t)strlen(p);
+        if (n == len && strncmp(p, hleFunctions[f].name, n) == 0) return true;
+        if (e == 0) break;
+        p = e + 1;
+    }
+    return false;
+}
+
+// find library functions in the symbol table that can be replaced by native versions
+void CEmulator::hleSetup() {
+    const char * list = cmd.getFilename(cmd.hleList);
+    // check names in command line list
+    const char * p = list;
+    while (*p && strcmp(list, "all") != 0) {
+        const char * e = strchr(p, ',');
+        uint32_t n = e ? uint32_t(e - p) : (uint32_t)strlen(p);
+        int f;
+        for (f = 0; f < numHleFunctions; f++) {
+            if (strlen(hleFunctions[f].name) == n && strncmp(p, hleFunctions[f].name, n) == 0) break;
+        }
+        if (f == numHleFunctions) {              // name not supported. report only this name
+            CMemoryBuffer name;
+            name.push(p, n);
+            name.push("", 1);
+            err.submit(ERR_UNKNOWN_OPTION, name.getString(0));
+        }
+        if (e == 0) break;
+        p = e + 1;
+    }
+    hleCalls.setNum(numHleFunctions);
+    hleCalls.zero();
+    for (uint32_t i = 0; i < symbols.numEntries(); i++) {
+        ElfFwcSym & sym = symbols[i];
+        if (sym.st_type != STT_FUNC || sym.st_section == 0 || sym.st_section >= sectionHeaders.numEntries()) continue;
+        if (!(sectionHeaders[sym.st_section].sh_flags & SHF_EXEC)) continue;
+        const char * name = symbolName(i);
+        if (name == 0) continue;
+        if (name[0] == '_') name++;              // ignore leading underscore
+        for (int f = 0; f < numHleFunctions; f++) {
+            if (strcmp(name, hleFunctions[f].name) == 0 && hleEnabled(list, f)) {
+                // code sections are addressed relative to ip0
+                SHleEntry entry;
+                entry.address = ip0 + sectionHeaders[sym.st_section].sh_addr + sym.st_value;
+                entry.function = f;
+                entry.unused = 0;
+                hleList.addUnique(entry);
+                break;
+            }
+        }
+    }
+    // address range for quick check
+    hleMin = ~uint64_t(0);  hleMax = 0;
+    if (hleList.numEntries()) {
+        hleMin = hleList[0].address;
+        hleMax = hleList[hleList.numEntries() - 1].address;
+    }
+}
+
+// write statistics of calls to native library functions
+void CEmulator::hleReport() {
+    printf("\n\nNative library functions:");
+    for (uint32_t i = 0; i < hleList.numEntries(); i++) {
+        uint32_t f = hleList[i].function;
+        printf("\n%-10s %10llu calls", hleFunctions[f].name, (unsigned long long)hleCalls[f]);
+    }
+    if (hleList.numEntries() == 0) printf("\nnone found");
+    printf("\n");
+}
+
+// check if the current instruction pointer is the entry of a library function with a native replacement.
+// Return true if the native function has been executed.
+bool CThread::hleCall() {
+    if (ip < emulator->hleMin || ip > emulator->hleMax) return false;
+    SHleEntry rec;
+    rec.address = ip;
+    int32_t i = emulator->hleList.findFirst(rec);
+    if (i < 0) return false;
+    uint32_t f = emulator->hleList[i].function;
+    if (listFileName && cmd.maxLines != 0) {     // debug listing
+        listOut.tabulate(emulator->disassembler.asmTab0);
+        listOut.put("native function: ");
+        listOut.put(hleFunctions[f].name);
+        listOut.newLine();
+    }
+    if (!hleFunctions[f].func(this)) return true; // interrupt has been generated
+    emulator->hleCalls[f]++;
+    // return to caller
+    if (callStack.numEntries() == 0) {
+        interrupt(INT_CALL_STACK);               // call stack empty
+        ip = entry_point;
+    }
+    else {
+        ip = callStack.pop();                    // pop return address
+    }
+    return true;
+}
@@ -0,0 +1,299 @@
+/****************************  emulator8.cpp  ********************************
+* Author:        Agner Fog
+* date created:  2026-10-18
+* Last modified: 2026-10-18
+* Version:       1.14
+* Project:       Binary tools for ForwardCom instruction set
+* Description:
+* Emulator: Heap allocator for the system functions malloc, free, and realloc
+*
+* The heap is placed after the last data section. Its size is 1 MB by default
+* and can be changed with the command line option -heap=N.
+* The heap is divided into pages of heap_page_size bytes. Small blocks of up to
+* heap_max_small bytes are rounded up to one of heap_num_classes size classes
+* and allocated from pages dedicated to one size class. Larger blocks occupy a
+* run of whole pages. Free pages are kept in a list of runs that are merged
+* with their neighbors when possible.
+* All allocator metadata are kept in host memory outside the emulated memory,
+* so that the emulated program cannot overwrite them.
+*
+* Copyright 2018-2026 GNU General Public License http://www.gnu.org/licenses
+*****************************************************************************/
+
+#include "stdafx.h"
+
+// block sizes of each size class
+static const uint32_t heapClassSizes[heap_num_classes] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048};
+
+// find size class for small block
+static uint32_t heapSizeClass(uint64_t size) {
+    if (size <= 128) return size == 0 ? 0 : uint32_t((size - 1) >> 4);
+    uint32_t c = 8;
+    while (heapClassSizes[c] < size) c++;
+    return c;
+}
+
+// initialize heap allocator
+void CEmulator::heapSetup(uint64_t start) {
+    heapStart = start;
+    uint32_t numPages = uint32_t(heapSize >> heap_page_shift);
+    heapPages.setNum(numPages);
+    heapPages.zero();
+    heapUsedBits.setNum(numPages * 4);
+    heapUsedBits.zero();
+    heapTop = heapTopPeak = 0;
+    heapInUse = heapPeak = 0;
+    for (int i = 0; i < 4; i++) heapCalls[i] = 0;
+}
+
+// mark first and last page of free run number i
+void CEmulator::heapTagFreeRun(uint32_t i) {
+    SHeapRun & run = heapFreeRuns[i];
+    heapPages[run.page].type = heap_page_free;
+    heapPages[run.page].value = i;
+    heapPages[run.page + run.num - 1].type = heap_page_free;
+    heapPages[run.page + run.num - 1].value = i;
+}
+
+// remove entry number i from list of free runs
+void CEmulator::heapRemoveFreeRun(uint32_t i) {
+    SHeapRun last = heapFreeRuns.pop();
+    if (i < heapFreeRuns.numEntries()) {
+        heapFreeRuns[i] = last;                  // move last entry into the vacant place
+        heapTagFreeRun(i);
+    }
+}
+
+// allocate a run of pages. return index of first page, or ~0 if failed
+uint32_t CEmulator::heapAllocPages(uint32_t num) {
+    uint32_t page;
+    // first fit search in list of free runs
+    for (uint32_t i = 0; i < heapFreeRuns.numEntries(); i++) {
+        SHeapRun & run = heapFreeRuns[i];
+        if (run.num >= num) {
+            page = run.page;
+            heapPages[run.page + run.num - 1].type = heap_page_unused; // remove old tags
+            heapPages[page].type = heap_page_unused;
+            if (run.num > num) {                 // use first part of run
+                run.page += num;  run.num -= num;
+                heapTagFreeRun(i);
+            }
+            else heapRemoveFreeRun(i);
+            return page;
+        }
+    }
+    // take pages from unused space at the top
+    if (num > heapPages.numEntries() - heapTop) return ~uint32_t(0);
+    page = heapTop;
+    heapTop += num;
+    if (heapTop > heapTopPeak) heapTopPeak = heapTop;
+    return page;
+}
+
+// free a run of pages and merge it with neighboring free runs
+void CEmulator::heapFreePages(uint32_t page, uint32_t num) {
+    uint32_t i;
+    for (i = 0; i < num; i++) heapPages[page + i].type = heap_page_unused;
+    // merge with preceding free run
+    if (page > 0 && heapPages[page - 1].type == heap_page_free) {
+        i = heapPages[page - 1].value;
+        SHeapRun run = heapFreeRuns[i];
+        heapPages[run.page].type = heap_page_unused;
+        heapPages[page - 1].type = heap_page_unused;
+        heapRemoveFreeRun(i);
+        page = run.page;  num += run.num;
+    }
+    // merge with following free run
+    if (page + num < heapTop && heapPages[page + num].type == heap_page_free) {
+        i = heapPages[page + num].value;
+        SHeapRun run = heapFreeRuns[i];
+        heapPages[run.page].type = heap_page_unused;
+        heapPages[run.page + run.num - 1].type = heap_page_unused;
+        heapRemoveFreeRun(i);
+        num += run.num;
+    }
+    if (page + num == heapTop) {
+        heapTop = page;                          // return to unused space at the top
+    }
+    else {
+        SHeapRun run = {page, num};
+        heapTagFreeRun(heapFreeRuns.push(run));
+    }
+}
+
+// size of allocated block. return 0 if address is not the start of an allocated block
+uint64_t CEmulator::heapBlockSize(uint64_t address) {
+    if (address < heapStart || address >= heapStart + ((uint64_t)heapPages.numEntries() << heap_page_shift)) return 0;
+    uint64_t offset = address - heapStart;
+    uint32_t page = uint32_t(offset >> heap_page_shift);
+    uint32_t withinPage = uint32_t(offset & (heap_page_size - 1));
+    SHeapPage & p = heapPages[page];
+    if (p.type == heap_page_small) {
+        uint32_t size = heapClassSizes[p.value];
+        if (withinPage % size) return 0;         // not at block boundary
+        uint32_t slot = withinPage / size;
+        if (!(heapUsedBits[page * 4 + (slot >> 6)] & ((uint64_t)1 << (slot & 63)))) return 0; // not allocated
+        return size;
+    }
+    if (p.type == heap_page_large && withinPage == 0) {
+        return (uint64_t)p.value << heap_page_shift;
+    }
+    return 0;
+}
+
+// allocate block on heap. return 0 if failed
+uint64_t CEmulator::heapAlloc(uint64_t size) {
+    uint64_t address;
+    if (size > heapSize) {                       // too big. check before rounding up to avoid overflow
+        heapCalls[3]++;  return 0;
+    }
+    if (size <= heap_max_small) {
+        uint32_t c = heapSizeClass(size);
+        uint32_t blockSize = heapClassSizes[c];
+        CDynamicArray<uint64_t> & freeList = heapFreeBlocks[c];
+        if (freeList.numEntries() == 0) {
+            // get a new page and divide it into blocks
+            uint32_t page = heapAllocPages(1);
+            if (page == ~uint32_t(0)) {
+                heapCalls[3]++;  return 0;       // heap full
+            }
+            heapPages[page].type = heap_page_small;
+            heapPages[page].value = c;
+            uint64_t pageAddress = heapStart + ((uint64_t)page << heap_page_shift);
+            // push in reverse order so that blocks are allocated in ascending order
+            for (uint32_t n = heap_page_size / blockSize; n > 0; n--) {
+                freeList.push(pageAddress + (n - 1) * blockSize);
+            }
+        }
+        address = freeList.pop();
+        uint64_t offset = address - heapStart;
+        uint32_t page = uint32_t(offset >> heap_page_shift);
+        uint32_t slot = uint32_t(offset & (heap_page_size - 1)) / blockSize;
+        heapUsedBits[page * 4 + (slot >> 6)] |= (uint64_t)1 << (slot & 63);
+        heapInUse += blockSize;
+    }
+    else {
+        uint64_t num = (size + heap_page_size - 1) >> heap_page_shift;
+        uint32_t page = num <= heapPages.numEntries() ? heapAllocPages(uint32_t(num)) : ~uint32_t(0);
+        if (page == ~uint32_t(0)) {
+            heapCalls[3]++;  return 0;           // heap full
+        }
+        heapPages[page].type = heap_page_large;
+        heapPages[page].value = uint32_t(num);
+        address = heapStart + ((uint64_t)page << heap_page_shift);
+        heapInUse += num << heap_page_shift;
+    }
+    if (heapInUse > heapPeak) heapPeak = heapInUse;
+    return address;
+}
+
+// free block on heap. return false if address is invalid
+bool CEmulator::heapFree(uint64_t address) {
+    if (address == 0) return true;              // free(NULL) does nothing
+    uint64_t size = heapBlockSize(address);
+    if (size == 0) return false;                 // not an allocated block
+    uint64_t offset = address - heapStart;
+    uint32_t page = uint32_t(offset >> heap_page_shift);
+    SHeapPage & p = heapPages[page];
+    if (p.type == heap_page_small) {
+        uint32_t slot = uint32_t(offset & (heap_page_size - 1)) / (uint32_t)size;
+        heapUsedBits[page * 4 + (slot >> 6)] &= ~((uint64_t)1 << (slot & 63));
+        heapFreeBlocks[p.value].push(address);
+    }
+    else {
+        heapFreePages(page, p.value);
+    }
+    heapInUse -= size;
+    return true;
+}
+
+// resize block on heap. address is replaced by the new address, or 0 if failed.
+// return false if address is invalid
+bool CEmulator::heapRealloc(uint64_t & address, uint64_t size) {
+    if (address == 0) {                          // realloc(NULL, size) is the same as malloc(size)
+        address = heapAlloc(size);
+        return true;
+    }
+    uint64_t oldSize = heapBlockSize(address);
+    if (oldSize == 0) return false;              // not an allocated block
+    if (size == 0) {                             // realloc(p, 0) is the same as free(p)
+        heapFree(address);
+        address = 0;
+        return true;
+    }
+    if (size > heapSize) {                       // too big. the old block is unchanged
+        heapCalls[3]++;  address = 0;
+        return true;
+    }
+    if (oldSize <= heap_max_small) {
+        // small block. keep it if the size class is the same
+        if (size <= heap_max_small && heapClassSizes[heapSizeClass(size)] == oldSize) return true;
+    }
+    else if (size > heap_max_small) {
+        // large block. try to resize in place
+        uint32_t page = uint32_t((address - heapStart) >> heap_page_shift);
+        uint32_t oldNum = uint32_t(oldSize >> heap_page_shift);
+        uint64_t num = (size + heap_page_size - 1) >> heap_page_shift;
+        if (num <= oldNum) {
+            // shrink. free the pages at the end
+            if (num < oldNum) {
+                heapPages[page].value = uint32_t(num);
+                heapFreePages(page + uint32_t(num), oldNum - uint32_t(num));
+                heapInUse -= (uint64_t)(oldNum - num) << heap_page_shift;
+            }
+            return true;
+        }
+        uint64_t extra = num - oldNum;           // number of pages to add
+        uint32_t next = page + oldNum;           // page after block
+        if (next == heapTop && extra <= heapPages.numEntries() - heapTop) {
+            // block is at the top. extend into unused space
+            heapTop += uint32_t(extra);
+            if (heapTop > heapTopPeak) heapTopPeak = heapTop;
+        }
+        else if (next < heapTop && heapPages[next].type == heap_page_free
+        && heapFreeRuns[heapPages[next].value].num >= extra) {
+            // extend into the following free run
+            uint32_t i = heapPages[next].value;
+            SHeapRun & run = heapFreeRuns[i];
+            heapPages[run.page + run.num - 1].type = heap_page_unused;
+            heapPages[run.page].type = heap_page_unused;
+            if (run.num > extra) {
+                run.page += uint32_t(extra);  run.num -= uint32_t(extra);
+                heapTagFreeRun(i);
+            }
+            else heapRemoveFreeRun(i);
+        }
+        else extra = 0;                          // cannot resize in place
+        if (extra) {
+            heapPages[page].value = uint32_t(num);
+            heapInUse += extra << heap_page_shift;
+            if (heapInUse > heapPeak) heapPeak = heapInUse;
+            return true;
+        }
+    }
+    // allocate new block and copy data
+    uint64_t newAddress = heapAlloc(size);
+    if (newAddress == 0) {                       // failed. the old block is unchanged
+        address = 0;
+        return true;
+    }
+    memcpy(memory + newAddress, memory + address, size_t(size < oldSize ? size : oldSize));
+    heapFree(address);
+    address = newAddress;
+    return true;
+}
+
+// write heap statistics
+void CEmulator::heapReport() {
+    printf("\n\nHeap:");
+    printf("\nheap size        %12llu bytes", (unsigned long long)heapPages.numEntries() << heap_page_shift);
+    printf("\nhigh-water mark  %12llu bytes", (unsigned long long)heapTopPeak << heap_page_shift);
+    printf("\npeak allocated   %12llu bytes", (unsigned long long)heapPeak);
+    printf("\nallocated at end %12llu bytes", (unsigned long long)heapInUse);
+    printf("\nmalloc calls     %12llu", (unsigned long long)heapCalls[0]);
+    printf("\nfree calls       %12llu", (unsigned long long)heapCalls[1]);
+    printf("\nrealloc calls    %12llu", (unsigned long long)heapCalls[2]);
+    printf("\nfailed           %12llu", (unsigned long long)heapCalls[3]);
+    printf("\n");
+}
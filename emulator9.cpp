@@ -0,0 +1,264 @@
+/****************************  emulator9.cpp  ********************************
+* Author:        Agner Fog
+* date created:  2026-10-18
+* Last modified: 2026-10-18
+* Version:       1.14
+* Project:       Binary tools for ForwardCom instruction set
+* Description:
+* Emulator: Breakpoints and watchpoints
+*
+* Breakpoints are specified with the command line option -break=b1,b2,...
+* Each breakpoint is a code symbol or a code address as shown in the debug
+* listing, optionally followed by a condition :rN=value or :rN!=value.
+* Symbols can be used only if they are included in the executable file.
+* Watchpoints are specified with -watch=w1,w2,... Each watchpoint is a data
+* symbol or an absolute data address, optionally followed by :size, by :r, :w,
+* or :rw for read and/or write access, and by a condition.
+*
+* Code and data ranges with a breakpoint or watchpoint get their own memory
+* map entries with execute, read, or write permission removed. A failed
+* permission check then looks up the original permission and the list of
+* breakpoints. Memory ranges without breakpoints or watchpoints are checked
+* in the normal way, so breakpoints cost nothing elsewhere.
+*
+* The registers are written to stdout when a breakpoint or watchpoint is hit.
+* If a debug listing is specified, it starts at the first hit.
+* The option -listat=location uses the same mechanism to start the debug
+* listing silently when a code address is reached.
+*
+* Copyright 2018-2026 GNU General Public License http://www.gnu.org/licenses
+*****************************************************************************/
+
+#include "stdafx.h"
+
+// find address of symbol in memory. return false if not found
+bool CEmulator::symbolAddress(const char * name, uint64_t & address) {
+    for (uint32_t i = 0; i < symbols.numEntries(); i++) {
+        ElfFwcSym & sym = symbols[i];
+        if (sym.st_section == 0 || sym.st_section >= sectionHeaders.numEntries()) continue;
+        if (sym.st_name == 0 || strcmp(stringBuffer.getString(sym.st_name), name) != 0) continue;
+        // find program header containing section
+        for (uint32_t ph = 0; ph < programHeaders.numEntries(); ph++) {
+            uint32_t phFirstSection = (uint32_t)programHeaders[ph].p_paddr;
+            uint32_t phNumSections = (uint32_t)(programHeaders[ph].p_paddr >> 32);
+            if (sym.st_section >= phFirstSection && sym.st_section < phFirstSection + phNumSections) {
+                address = programHeaders[ph].p_vaddr + sectionHeaders[sym.st_section].sh_addr
+                    - sectionHeaders[phFirstSection].sh_addr + sym.st_value;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// interpret comma-separated list of breakpoints or watchpoints from command line
+void CEmulator::debugParse(const char * list, uint32_t type, uint16_t action) {
+    const char * p = list;
+    while (*p) {
+        const char * e = strchr(p, ',');         // find end of item
+        uint32_t n = e ? uint32_t(e - p) : (uint32_t)strlen(p);
+        SDebugPoint point;
+        zeroAllMembers(point);
+        point.type = type;
+        point.reg = debug_no_condition;
+        point.action = action;
+        // save text of item for messages, and a copy for parsing
+        point.name = debugNames.push(p, n);
+        debugNames.push("", 1);
+        uint32_t copy = debugNames.push(p, n);
+        debugNames.push("", 1);
+        char * text = debugNames.getString(copy);
+        char * mod = strchr(text, ':');          // modifiers after location
+        if (mod) *mod++ = 0;
+        // location is a symbol name or a hexadecimal address
+        bool error = false;
+        uint64_t address = 0;
+        if (text[0] >= '0' && text[0] <= '9') {
+            char * end;
+            address = strtoull(text, &end, 16);
+            if (*end) error = true;
+            // code addresses are in units of 32-bit words relative to the code section, as in the debug listing
+            if (type == debug_break) address = debugCodeBase + (address << 2);
+        }
+        else if (!symbolAddress(text, address)) error = true;
+        point.address = address;
+        point.end = address + (type == debug_break ? 4 : 8);
+        // interpret modifiers
+        while (mod && !error) {
+            char * next = strchr(mod, ':');
+            if (next) *next++ = 0;
+            char * end = mod;
+            if ((mod[0] | 0x20) == 'r' && mod[1] >= '0' && mod[1] <= '9') {
+                // condition on register. only one condition allowed
+                if (point.reg != debug_no_condition) error = true;
+                point.reg = (uint8_t)strtoul(mod + 1, &end, 10);
+                if (end[0] == '!') {
+                    point.notEqual = 1;  end++;
+                }
+                if (end[0] != '=' || point.reg > 31) error = true;
+                else point.value = strtoull(end + 1, &end, 0);
+            }
+            else if (type != debug_break && (strcmp(mod, "r") == 0 || strcmp(mod, "R") == 0)) {
+                point.type = debug_watch_read;  end = mod + 1;
+            }
+            else if (type != debug_break && (strcmp(mod, "w") == 0 || strcmp(mod, "W") == 0)) {
+                point.type = debug_watch_write;  end = mod + 1;
+            }
+            else if (type != debug_break && strncasecmp_(mod, "rw", 2) == 0) {
+                point.type = debug_watch_read | debug_watch_write;  end = mod + 2;
+            }
+            else if (type != debug_break && mod[0] >= '0' && mod[0] <= '9') {
+                point.end = point.address + strtoull(mod, &end, 0);  // size of watched range
+            }
+            if (*end || end == mod) error = true;
+            mod = next;
+        }
+        if (error) err.submit(ERR_UNKNOWN_OPTION, debugNames.getString(point.name));
+        else debugPoints.push(point);
+        if (e == 0) break;
+        p = e + 1;
+    }
+}
+
+// give address range its own memory map entries and remove access permissions from it
+void CEmulator::debugProtect(uint64_t start, uint64_t end, uint32_t permissions) {
+    start &= ~(uint64_t)7;                       // map boundaries must be divisible by 8
+    end = (end + 7) & ~(uint64_t)7;
+    CDynamicArray<SMemoryMap> newMap;
+    for (uint32_t i = 0; i < memoryMap.numEntries(); i++) {
+        SMemoryMap entry = memoryMap[i];
+        if (i + 1 == memoryMap.numEntries()) {   // terminating entry
+            newMap.push(entry);  break;
+        }
+        uint64_t next = memoryMap[i+1].startAddress;
+        if (end <= entry.startAddress || start >= next) {
+            newMap.push(entry);  continue;       // entry does not overlap range
+        }
+        // split entry into the parts before, inside, and after range
+        if (start > entry.startAddress) newMap.push(entry);
+        SMemoryMap inside = entry;
+        if (start > inside.startAddress) inside.startAddress = start;
+        inside.access_addend &= ~(uint64_t)permissions;
+        newMap.push(inside);
+        if (end < next) {
+            entry.startAddress = end;
+            newMap.push(entry);
+        }
+    }
+    memoryMap.copy(newMap);
+}
+
+// remove access permissions for all breakpoints and watchpoints from memory map
+void CEmulator::debugUpdateMap() {
+    memoryMap.copy(debugMap);
+    for (uint32_t i = 0; i < debugPoints.numEntries(); i++) {
+        debugProtect(debugPoints[i].address, debugPoints[i].end, debugPoints[i].type);
+    }
+}
+
+// set up breakpoints and watchpoints from command line
+void CEmulator::debugSetup() {
+    debugMap.copy(memoryMap);                    // save original access permissions
+    // find start of first code section
+    debugCodeBase = ~uint64_t(0);
+    for (uint32_t sec = 1; sec < sectionHeaders.numEntries(); sec++) {
+        if ((sectionHeaders[sec].sh_flags & SHF_EXEC) && ip0 + sectionHeaders[sec].sh_addr < debugCodeBase) {
+            debugCodeBase = ip0 + sectionHeaders[sec].sh_addr;
+        }
+    }
+    if (debugCodeBase == ~uint64_t(0)) debugCodeBase = ip0;
+    if (cmd.breakList) debugParse(cmd.getFilename(cmd.breakList), debug_break, debug_action_report);
+    if (cmd.watchList) debugParse(cmd.getFilename(cmd.watchList), debug_watch_write, debug_action_report);
+    if (cmd.listAt && cmd.outputListFile) debugParse(cmd.getFilename(cmd.listAt), debug_break, debug_action_list);
+    for (uint32_t i = 0; i < debugPoints.numEntries(); i++) {
+        SDebugPoint & p = debugPoints[i];
+        if (p.end > memsize || p.end <= p.address) {
+            err.submit(ERR_UNKNOWN_OPTION, debugNames.getString(p.name));  return; // address out of range
+        }
+    }
+    debugUpdateMap();
+    if (cmd.outputListFile && (debugPoints.numEntries() || cmd.listStartCount || cmd.listLast)) {
+        // start debug listing at first hit or after cmd.listStartCount instructions.
+        // with only -listlast, the listing contains only the last instructions before an interrupt
+        debugMaxLines = cmd.maxLines;
+        cmd.maxLines = 0;
+    }
+}
+
+// Check breakpoints and watchpoints when the access permission check fails.
+// mode = SHF_EXEC, SHF_READ, or SHF_WRITE.
+// Return true if the access is allowed by the original memory map
+bool CThread::debugAccess(uint64_t address, uint64_t size, uint32_t mode) {
+    CDynamicArray<SDebugPoint> & points = emulator->debugPoints;
+    if (points.numEntries() == 0) return false;  // no breakpoints. access violation
+    // find entry in original memory map by binary search
+    CDynamicArray<SMemoryMap> & map = emulator->debugMap;
+    uint32_t a = 0, b = map.numEntries() - 1;
+    if (address < map[a].startAddress || address + size > map[b].startAddress) return false;
+    while (b - a > 1) {
+        uint32_t m = (a + b) >> 1;
+        if (address < map[m].startAddress) b = m;
+        else a = m;
+    }
+    // check original permission. the access may cross into the next map entry
+    if (!(map[a].access_addend & mode)) return false;
+    if (address + size > map[a+1].startAddress && !(map[a+1].access_addend & mode)) return false;
+    if (debugSuspend) return true;
+    // find breakpoints or watchpoints covering the accessed address
+    for (uint32_t i = 0; i < points.numEntries(); i++) {
+        SDebugPoint & p = points[i];
+        if (!(p.type & mode)) continue;
+        if (mode == SHF_EXEC) {
+            if (address != p.address) continue;  // other instruction in same map entry
+        }
+        else if (address >= p.end || address + size <= p.address) continue;
+        if (p.reg != debug_no_condition && (registers[p.reg] == p.value) == (p.notEqual != 0)) continue;
+        if (p.action == debug_action_list) {
+            listResume();                        // start debug listing
+            continue;
+        }
+        if (p.action == debug_action_gdb) {
+            // stop and report to GDB. a breakpoint stops before the instruction is executed
+            if (mode == SHF_EXEC && address == gdbIgnoreAddress) continue;
+            gdbSignal = 5;                       // SIGTRAP
+            gdbWatchType = mode == SHF_EXEC ? 0 : p.type;
+            gdbWatchAddress = address;
+            continue;
+        }
+        debugHit(i, address, mode);
+    }
+    return true;
+}
+
+// report breakpoint or watchpoint number i
+void CThread::debugHit(uint32_t i, uint64_t address, uint32_t mode) {
+    SDebugPoint & p = emulator->debugPoints[i];
+    p.hits++;
+    const char * name = emulator->debugNames.getString(p.name);
+    uint64_t instructions = ninstructions + perfCounters[perf_instructions];
+    // address of current instruction, in words as in the debug listing
+    uint64_t iaddress = mode == SHF_EXEC ? address : (uint64_t)((const int8_t*)pInstr - memory);
+    iaddress = (iaddress - emulator->debugCodeBase) >> 2;
+    if (mode == SHF_EXEC) {
+        printf("\nBreakpoint %s at %04llX after %llu instructions",
+            name, (unsigned long long)iaddress, (unsigned long long)instructions);
+    }
+    else {
+        printf("\nWatchpoint %s: %s at 0x%llX by instruction at %04llX after %llu instructions",
+            name, mode == SHF_WRITE ? "write" : "read", (unsigned long long)address,
+            (unsigned long long)iaddress, (unsigned long long)instructions);
+    }
+    for (int r = 0; r < 32; r++) {
+        printf("%sr%-2i = %016llX", (r & 3) ? "   " : "\n", r, (unsigned long long)registers[r]);
+    }
+    printf("\n");
+    if (listFileName) {
+        listResume();                            // start debug listing
+        if (cmd.maxLines != 0) {
+            listOut.tabulate(emulator->disassembler.asmTab0);
+            listOut.put(mode == SHF_EXEC ? "breakpoint " : "watchpoint ");
+            listOut.put(name);
+            listOut.newLine();
+        }
+    }
+}
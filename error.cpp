@@ -73,6 +73,11 @@ SErrorText errorTexts[] = {
     {ERR_LINK_UNRESOLVED, 2, "Unresolved external symbol %s in module %s"}, // symbol not found in any module or library
     {ERR_LINK_UNRESOLVED_WARN, 1, "Unresolved external symbol %s in module %s"}, // symbol not found. warn only because incomplete output allowed
 
+    {ERR_REPLAY_FILE, 2, "Replay file %s was not recorded with this executable file"}, // replay file header does not match
+    {ERR_REPLAY_MISMATCH, 2, "Replay out of sync at system function %s"}, // system call does not match replay file
+    {ERR_GDB_CONNECT, 2, "Cannot open connection for GDB on port %i"}, // socket error
+    {ERR_REPLAY_TOO_BIG, 2, "Record file too big at system function %s"}, // recorded data exceed 2 GB
+
     // Error messages
     {ERR_MULTIPLE_IO_FILES, 2, "No more than one input file and one output file can be specified"}, //?
     {ERR_MULTIPLE_COMMANDS, 2, "More than one command specified on command line: %s"},
@@ -175,6 +180,8 @@ SErrorText assemErrorTexts[] = {
     {ERR_DATA_WO_SECTION,    1, "data without section: "},
     {ERR_MIX_DATA_AND_CODE,  1, "code and data in same section: "},
     {ERR_MUST_BE_CONSTANT,   1, "value must be constant: "},
+    {ERR_INCLUDE_FILE,       1, "cannot read include file: "},
+    {ERR_INCLUDE_DEPTH,      1, "include files nested too deeply: "},
     {ERR_MEM_COMPONENT_TWICE,1, "component of memory operand specified twice: "},
     {ERR_SCALE_FACTOR,       1, "wrong scale factor for this instruction: "},
     {ERR_MUST_BE_GP,         1, "vector length must be general purpose register: "},
@@ -456,7 +463,6 @@ void CAssemErrors::outputErrors() {
     if (list.numEntries() == 0) return;
     const char * text1;
     char text2[256];
-    const char * filename = cmd.getFilename(cmd.inputFile); // owner->fileName; // to do: support include filenames
     const uint32_t errorTextsLength = TableSize(assemErrorTexts);
     uint32_t i, j, texti;
 
@@ -468,18 +474,20 @@ void CAssemErrors::outputErrors() {
             lastPass = list[i].pass;
         }
 
-        // find line containing error
-        uint32_t line;
+        // find line containing error. Lines from include files are placed where they are included,
+        // while their text is after the source file, so the lines are not sorted by position
+        uint32_t line = 0;
         uint32_t numLines = owner->lines.numEntries();
         uint32_t pos = list[i].pos;
-        for (line = 0; line < numLines; line++) {
-            if (pos < owner->lines[line].beginPos) break;
+        for (j = 0; j < numLines; j++) {
+            if (owner->lines[j].beginPos <= pos && owner->lines[j].beginPos >= owner->lines[line].beginPos) line = j;
         }
-        line--;
         // if this line has multiple records in lines[] then find the first one
         j = line;
-        while (j > 0 && owner->lines[j - 1].linenum == owner->lines[line].linenum) j--;
+        while (j > 0 && owner->lines[j - 1].linenum == owner->lines[line].linenum 
+            && owner->lines[j - 1].file == owner->lines[line].file) j--;
         line = j;
+        const char * filename = owner->fileName(owner->lines[line].file);
 
         // find column
         uint32_t pos1 = owner->lines[line].beginPos;
@@ -77,6 +77,11 @@ const int ERR_INPUT_NOT_RELINKABLE     = 319;
 const int ERR_LINK_UNRESOLVED          = 320;
 const int ERR_LINK_UNRESOLVED_WARN     = 321;
 
+const int ERR_REPLAY_FILE              = 400;
+const int ERR_REPLAY_MISMATCH          = 401;
+const int ERR_GDB_CONNECT              = 402;
+const int ERR_REPLAY_TOO_BIG           = 403;
+
 const int ERR_TOO_MANY_ERRORS          = 500;
 const int ERR_BIG_ENDIAN               = 501;
 const int ERR_INTERNAL                 = 502;
@@ -123,6 +128,8 @@ const int ERR_CODE_WO_SECTION          = 0x127;  // code without section
 const int ERR_DATA_WO_SECTION          = 0x128;  // data without section
 const int ERR_MIX_DATA_AND_CODE        = 0x129;  // mixing data and code in same section
 const int ERR_MUST_BE_CONSTANT         = 0x12A;  // option value must be constant
+const int ERR_INCLUDE_FILE             = 0x12B;  // cannot read include file
+const int ERR_INCLUDE_DEPTH            = 0x12C;  // include files nested too deeply
 const int ERR_MEM_COMPONENT_TWICE      = 0x140;  // component of memory operand specified twice
 const int ERR_SCALE_FACTOR             = 0x141;  // wrong scale factor
 const int ERR_MUST_BE_GP               = 0x142;  // length or broadcast must be general purpose register
@@ -64,6 +64,7 @@ void CLinker::go() {
 
     // read specified object files and library files
     fillBuffers();
+    timingStage("fillBuffers");
     if (err.number()) return;
 
     // make list of imported and exported symbols
@@ -72,10 +73,12 @@ void CLinker::go() {
 
     // match lists of imported and exported symbols
     matchSymbols();
+    timingStage("matchSymbols");
     if (err.number()) return;
 
     // search libraries for imported symbols
     librarySearch();
+    timingStage("librarySearch");
     if (err.number()) return;
 
     // write feedback to console
@@ -87,18 +90,22 @@ void CLinker::go() {
 
     // get imported library modules into modules2 buffer
     readLibraryModules();
+    timingStage("readLibraryModules");
     if (err.number()) return;
 
     // make list of all sections
     makeSectionList();
+    timingStage("makeSectionList");
     if (err.number()) return;
 
     // make program headers and assign addresses to sections
     makeProgramHeaders();
+    timingStage("makeProgramHeaders");
     if (err.number()) return;
 
     // put values into all cross references
     relocate();
+    timingStage("relocate");
     if (err.number()) return;
 
     // make sorted event list
@@ -106,6 +113,7 @@ void CLinker::go() {
 
     // copy sections to output file
     copySections();
+    timingStage("copySections");
 
     // copy symbols to output file
     copySymbols();
@@ -143,6 +151,7 @@ void CLinker::go() {
         // write output file
         outFile.write(cmd.getFilename(cmd.outputFile));
     }
+    timingStage("write");
 }
 
 CLinker::CLinker() {
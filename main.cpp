@@ -18,6 +18,15 @@
 
 #include "stdafx.h"
 
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>                   // for timing functions
+#else
+#include <unistd.h>                    // fork
+#include <sys/wait.h>                  // waitpid
+#endif
+
 // Check if running on little endian system
 static void CheckEndianness();
 
@@ -43,9 +52,11 @@ int main(int argc, char * argv[]) {
 
     cmd.readCommandLine(argc, argv);             // Read command line parameters   
     if (cmd.job == CMDL_JOB_HELP) return 0;      // Help screen has been printed. Do nothing else
+    if (cmd.timings) timingStart();              // Start timing report
 
     CConverter maincvt;                          // This object takes care of all conversions etc.
     maincvt.go();                                // Do everything the command line says
+    timingReport();                              // Report time used if -timings option
 
     if (cmd.verbose && cmd.job != CMDL_JOB_EMU)  printf("\n"); // End with newline
     if (err.getWorstError()) cmd.mainReturnValue = err.getWorstError(); // Return with error code
@@ -76,6 +87,10 @@ void CConverter::go() {
 
     case CMDL_JOB_ASS:
         // assemble
+        if (cmd.fileList.numEntries()) {
+            assembleFiles();           // multiple files
+            break;
+        }
         readInputFile();
         if (err.number()) return;
         assemble();
@@ -103,6 +118,10 @@ void CConverter::go() {
         emulate();    // emulator
         break;
 
+    case CMDL_JOB_TABLE:
+        instructionTable();  // C++ header with instruction list
+        break;
+
     case 0: return; // no job. command line error
 
     default:
@@ -116,6 +135,7 @@ void CConverter::readInputFile() {
     int IgnoreError = (cmd.fileOptions & CMDL_FILE_IN_IF_EXISTS);
     // Read input file
     read(cmd.getFilename(cmd.inputFile), IgnoreError);
+    timingStage("read");
     if (cmd.job == CMDL_JOB_ASS) fileType = FILETYPE_ASM;
     else getFileType();                 // Determine file type
     if (err.number()) return;           // Return if error
@@ -146,6 +166,116 @@ void CConverter::assemble() {
     ass.go();                          // run
 } 
 
+// Assemble multiple files specified on the command line.
+// The files are assembled in separate processes where fork is available, cmd.numJobs at a time.
+// Each process has its own copy of the global symbol name buffer, command line, and error
+// reporter. The instruction list is loaded before the processes are started so that they
+// can share it. The console output of each process is saved in temporary files and written
+// in the order of the files. Without fork, the files are assembled one by one
+void CConverter::assembleFiles() {
+    CCSVFile instructionList;
+    instructionList.load();            // later calls to load() copy the same lists
+    if (err.number()) return;
+    cmd.inputType = fileType = FILETYPE_ASM;
+    uint32_t numFiles = cmd.fileList.numEntries();
+#if defined(_WIN32)
+    for (uint32_t i = 0; i < numFiles; i++) {
+        cmd.inputFile = cmd.fileList[i].filename;
+        cmd.outputFile = (uint32_t)cmd.fileList[i].value;
+        symbolNameBuffer.clear();      // symbol names from previous file
+        int errorsBefore = err.number();
+        if (cmd.timings) timingStart();
+        read(cmd.getFilename(cmd.inputFile));
+        timingStage("read");
+        if (err.number() != errorsBefore) continue;
+        CAssembler ass;
+        *this >> ass;                  // Give it my buffer
+        ass.go();
+        timingReport();                // timing report for each file
+    }
+#else
+    struct SJob {
+        pid_t pid;                     // process id. 0 when finished
+        FILE * out;                    // temporary file for stdout
+        FILE * errors;                 // temporary file for stderr
+    };
+    CDynamicArray<SJob> jobs;
+    jobs.setNum(numFiles);
+    jobs.zero();
+    uint32_t numJobs = cmd.numJobs;
+    if (numJobs == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        numJobs = n > 0 ? (uint32_t)n : 1;
+    }
+    uint32_t next = 0;                 // next file to start
+    uint32_t done = 0;                 // next file to report
+    uint32_t running = 0;              // number of running processes
+    bool failed = false;               // a process failed
+    {
+        CAssembler preload;            // the processes inherit the tokenized include files
+        preload.preloadIncludeFiles();
+    }
+    if (cmd.timings) timingStart();    // include files are not part of the timing report of any file
+    fflush(stdout);  fflush(stderr);   // don't let the child processes inherit buffered output
+    while (done < numFiles) {
+        // start processes. limit the number of temporary files waiting to be reported
+        while (!failed && next < numFiles && running < numJobs && next - done < numJobs * 2) {
+            SJob & job = jobs[next];
+            job.out = tmpfile();
+            job.errors = tmpfile();
+            if (job.out == 0 || job.errors == 0 || (job.pid = fork()) < 0) {
+                if (job.out) fclose(job.out);
+                if (job.errors) fclose(job.errors);
+                job.out = job.errors = 0;  job.pid = 0;
+                err.submit(ERR_INTERNAL);
+                failed = true;
+                numFiles = next;       // report files already started
+                break;
+            }
+            if (job.pid == 0) {
+                // child process. assemble one file
+                dup2(fileno(job.out), 1);
+                dup2(fileno(job.errors), 2);
+                cmd.inputFile = cmd.fileList[next].filename;
+                cmd.outputFile = (uint32_t)cmd.fileList[next].value;
+                if (cmd.timings) timingStart();
+                read(cmd.getFilename(cmd.inputFile));
+                timingStage("read");
+                if (err.number() == 0) assemble();
+                timingReport();
+                fflush(stdout);  fflush(stderr);
+                _exit(err.getWorstError() || cmd.mainReturnValue ? 1 : 0);
+            }
+            next++;  running++;
+        }
+        if (done >= numFiles) break;
+        // wait for any process to finish
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid <= 0) break;
+        for (uint32_t i = done; i < next; i++) {
+            if (jobs[i].pid == pid) {
+                jobs[i].pid = 0;  running--;
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) cmd.mainReturnValue = 1;
+                break;
+            }
+        }
+        // write output of finished processes in the order of the files
+        while (done < next && jobs[done].pid == 0) {
+            SJob & job = jobs[done++];
+            char buffer[4096];
+            size_t n;
+            rewind(job.out);
+            while ((n = fread(buffer, 1, sizeof(buffer), job.out)) > 0) fwrite(buffer, 1, n, stdout);
+            rewind(job.errors);
+            while ((n = fread(buffer, 1, sizeof(buffer), job.errors)) > 0) fwrite(buffer, 1, n, stderr);
+            fclose(job.out);  fclose(job.errors);
+            fflush(stdout);  fflush(stderr);
+        }
+    }
+#endif
+}
+
 void CConverter::disassemble() {
     // Disassemble ELF file
     // Make instance of disassembler
@@ -181,10 +311,84 @@ void CConverter::emulate() {
     emulator.go();                   // Do the job
 }
 
+void CConverter::instructionTable() {
+    // Make C++ header file from instruction list file
+    CCSVFile table;
+    table.read(cmd.getFilename(cmd.inputFile)); // Read instruction list file
+    if (err.number()) return;
+    table.makeHeader();                // Do the job
+}
+
+// Hardware conversion between half precision and single precision with the F16C
+// instructions, if supported by the CPU. The software versions below are used as
+// fallback and for the cases where the hardware gives a different result:
+// NaN (F16C sets the quiet bit), subnormal inputs when subnormals are not supported,
+// and subnormal outputs (the software version truncates rather than rounds).
+#if defined(_M_X64) || defined(__x86_64__) || defined(__amd64)
+#define F16C_DISPATCH 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define F16C_TARGET
+#else
+#include <cpuid.h>
+#include <immintrin.h>
+#define F16C_TARGET __attribute__((target("f16c")))
+#endif
+
+// Detect if the CPU and operating system support the F16C instructions
+static bool detectF16C() {
+    uint32_t ecx;
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 1);
+    ecx = (uint32_t)regs[2];
+#else
+    uint32_t eax, ebx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+#endif
+    // F16C instructions are VEX coded. They need F16C, AVX, and OS support for saving YMM registers
+    const uint32_t need = (1u << 29) | (1u << 28) | (1u << 27); // F16C, AVX, OSXSAVE
+    if ((ecx & need) != need) return false;
+#if defined(_MSC_VER)
+    uint64_t xcr0 = _xgetbv(0);
+#else
+    uint32_t xlo, xhi;
+    __asm__ ("xgetbv" : "=a"(xlo), "=d"(xhi) : "c"(0));
+    uint64_t xcr0 = ((uint64_t)xhi << 32) | xlo;
+#endif
+    return (xcr0 & 6) == 6;                      // XMM and YMM state enabled
+}
+
+// F16C support: -1 = not checked yet, 0 = not supported, 1 = supported
+static int f16cSupport = -1;
+
+static inline bool hasF16C() {
+    if (f16cSupport < 0) f16cSupport = detectF16C();
+    return f16cSupport != 0;
+}
+
+F16C_TARGET static float half2floatF16C(uint32_t half) {
+    return _mm_cvtss_f32(_mm_cvtph_ps(_mm_cvtsi32_si128((int)(half & 0xFFFF))));
+}
+
+F16C_TARGET static uint16_t float2halfF16C(float x) {
+    // immediate operand 0 = round to nearest or even, independent of MXCSR
+    return (uint16_t)_mm_cvtsi128_si32(_mm_cvtps_ph(_mm_set_ss(x), 0));
+}
+#else
+#define F16C_DISPATCH 0
+#endif
+
 // Convert half precision floating point number to single precision
 // Optional support for subnormals
 // NaN payload is left-justified for ForwardCom
 float half2float(uint32_t half, bool supportSubnormal) {
+#if F16C_DISPATCH
+    // use hardware conversion unless NaN, or subnormal without subnormal support
+    if (((half & 0x7C00) != 0 || supportSubnormal) && ((half & 0x7C00) != 0x7C00 || (half & 0x3FF) == 0) && hasF16C()) {
+        return half2floatF16C(half);
+    }
+#endif
     union {
         uint32_t hhh;
         float fff;
@@ -221,6 +425,19 @@ float half2float(uint32_t half, bool supportSubnormal) {
 // Optional support for subnormals
 // NaN payload is left-justified
 uint16_t float2half(float x, bool supportSubnormal) {
+#if F16C_DISPATCH
+    {   // use hardware conversion unless NaN or result is subnormal or zero
+        union {
+            float f;
+            uint32_t i;
+        } w;
+        w.f = x;
+        uint32_t expo = (w.i >> 23) & 0xFF;
+        if (expo >= 0x71 && (expo != 0xFF || (w.i & 0x7FFFFF) == 0) && hasF16C()) {
+            return float2halfF16C(x);
+        }
+    }
+#endif
     union {                                      // single precision float
         float f;
         struct {
@@ -358,6 +575,16 @@ uint32_t bitScanReverse(uint64_t x) {
     return r;
 }
 
+// Hash value of a block of data. FNV-1a 64 bit hash function
+uint64_t hashBytes(const void * p, uint64_t size) {
+    const uint8_t * q = (const uint8_t *)p;
+    uint64_t h = 0xCBF29CE484222325;             // offset basis
+    for (uint64_t i = 0; i < size; i++) {
+        h = (h ^ q[i]) * 0x100000001B3;          // FNV prime
+    }
+    return h;
+}
+
 // Bit scan forward. Returns index to the lowest set bit, 0 if x = 0
 uint32_t bitScanForward(uint64_t x) {
     uint32_t s = 32;  // shift count
@@ -374,6 +601,117 @@ uint32_t bitScanForward(uint64_t x) {
     return r;
 }
 
+// Wall clock time in seconds from an arbitrary starting point. Used for timing reports
+double wallTime() {
+#if defined(_WIN32)
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return double(count.QuadPart) / double(frequency.QuadPart);
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return double(t.tv_sec) + double(t.tv_nsec) * 1.E-9;
+#endif
+}
+
+// CPU time used by this process in seconds. Used for timing reports
+double cpuTime() {
+#if defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) return 0.;
+    // FILETIME values are in units of 100 ns
+    uint64_t k = (uint64_t)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime;
+    uint64_t u = (uint64_t)user.dwHighDateTime << 32 | user.dwLowDateTime;
+    return double(k + u) * 1.E-7;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+    return double(t.tv_sec) + double(t.tv_nsec) * 1.E-9;
+#endif
+}
+
+// Timing report for the -timings option.
+// Each job calls timingStage at the end of each stage. The peak memory is the maximum total size
+// of all CMemoryBuffer containers during the stage
+struct STimingStage {
+    const char * name;                 // name of stage
+    double wallTime;                   // wall clock time used
+    double cpuTime;                    // CPU time used
+    uint64_t peakSize;                 // maximum size of allocated buffers
+};
+static CDynamicArray<STimingStage> timingStages; // stages finished
+static double timingWallStart, timingCpuStart;  // time at start of job
+static double timingWall0, timingCpu0;          // time at start of current stage
+
+void timingStart() {
+    timingStages.setNum(0);
+    timingWallStart = timingWall0 = wallTime();
+    timingCpuStart = timingCpu0 = cpuTime();
+    CMemoryBuffer::peakSize = CMemoryBuffer::totalSize;
+}
+
+void timingStage(const char * name) {
+    if (!cmd.timings) return;
+    STimingStage stage;
+    double wall = wallTime(), cpu = cpuTime();
+    stage.name = name;
+    stage.wallTime = wall - timingWall0;
+    stage.cpuTime = cpu - timingCpu0;
+    stage.peakSize = CMemoryBuffer::peakSize;
+    timingStages.push(stage);
+    timingWall0 = wall;  timingCpu0 = cpu;       // next stage begins here
+    CMemoryBuffer::peakSize = CMemoryBuffer::totalSize;
+}
+
+// add a stage that the caller has measured, for jobs where one stage can interrupt another
+void timingStage(const char * name, double wall, double cpu, uint64_t peak) {
+    if (!cmd.timings) return;
+    STimingStage stage;
+    stage.name = name;
+    stage.wallTime = wall;
+    stage.cpuTime = cpu;
+    stage.peakSize = peak;
+    timingStages.push(stage);
+}
+
+void timingReport() {
+    if (!cmd.timings || timingStages.numEntries() == 0) return;
+    double totalWall = wallTime() - timingWallStart;  // includes time between named stages
+    double totalCpu = cpuTime() - timingCpuStart;
+    uint64_t peak = CMemoryBuffer::peakSize;
+    uint32_t i;
+    for (i = 0; i < timingStages.numEntries(); i++) {
+        if (timingStages[i].peakSize > peak) peak = timingStages[i].peakSize;
+    }
+    const char * filename = cmd.getFilename(cmd.inputFile ? cmd.inputFile : cmd.outputFile);
+    if (cmd.timings & CMDL_TIMINGS_JSON) {
+        printf("\n{\"file\": \"");
+        for (const char * p = filename; *p; p++) {
+            if (*p == '"' || *p == '\\') putchar('\\');  // escape for JSON string
+            putchar(*p);
+        }
+        printf("\", \"wall_time\": %.6f, \"cpu_time\": %.6f, \"peak_bytes\": %llu, \"stages\": [",
+            totalWall, totalCpu, (unsigned long long)peak);
+        for (i = 0; i < timingStages.numEntries(); i++) {
+            STimingStage & s = timingStages[i];
+            printf("%s{\"name\": \"%s\", \"wall_time\": %.6f, \"cpu_time\": %.6f, \"peak_bytes\": %llu}",
+                i ? ", " : "", s.name, s.wallTime, s.cpuTime, (unsigned long long)s.peakSize);
+        }
+        printf("]}\n");
+    }
+    else {
+        printf("\nTime and memory used for %s:", filename);
+        printf("\n%-20s %10s %10s %12s", "stage", "wall time", "CPU time", "peak memory");
+        for (i = 0; i < timingStages.numEntries(); i++) {
+            STimingStage & s = timingStages[i];
+            printf("\n%-20s %8.3f s %8.3f s %9llu kB", s.name, s.wallTime, s.cpuTime, (unsigned long long)(s.peakSize + 1023) >> 10);
+        }
+        printf("\n%-20s %8.3f s %8.3f s %9llu kB\n", "total", totalWall, totalCpu, (unsigned long long)(peak + 1023) >> 10);
+    }
+    timingStages.setNum(0);
+}
+
 const char * timestring(uint32_t t) {
     // Convert 32 bit time stamp to string
     // Fix the problem that time_t may be 32 bit or 64 bit
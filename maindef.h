@@ -88,6 +88,19 @@ uint32_t bitScanReverse(uint64_t x);
 // Bit scan forward. Returns index to the lowest set bit, 0 if x = 0
 uint32_t bitScanForward(uint64_t x);
 
+// Hash value of a block of data
+uint64_t hashBytes(const void * p, uint64_t size);
+
+// Wall clock time and CPU time in seconds, for timing reports
+double wallTime();
+double cpuTime();
+
+// Report of time and memory used in each stage of a job, for the -timings option
+void timingStart();                    // start timing. The first stage begins here
+void timingStage(const char * name);   // end of a stage. The next stage begins here
+void timingStage(const char * name, double wall, double cpu, uint64_t peak); // add a stage measured by the caller
+void timingReport();                   // write timing report to stdout
+
 // Convert 32 bit time stamp to string
 const char * timestring(uint32_t t);
 
@@ -70,6 +70,8 @@
 #define SYSF_FTELL                0x116  // get file position
 #define SYSF_FSEEK                0x117  // set file position
 #define SYSF_FERROR               0x118  // get file error
+#define SYSF_FREADV               0x119  // read from file into multiple buffers
+#define SYSF_FWRITEV              0x11A  // write multiple buffers to file
 #define SYSF_GETCHAR              0x120  // read character from stdin
 #define SYSF_FGETC                0x121  // read character from file
 #define SYSF_FGETS                0x123  // read string from file
@@ -78,3 +80,8 @@
 #define SYSF_FSCANF               0x131  // read formatted input from file
 #define SYSF_SSCANF               0x132  // read formatted input from string buffer
 #define SYSF_REMOVE               0x140  // delete file
+
+// memory allocation functions
+#define SYSF_MALLOC               0x200  // allocate memory on heap
+#define SYSF_FREE                 0x201  // free memory on heap
+#define SYSF_REALLOC              0x202  // resize memory block on heap